@@ -23,6 +23,9 @@ Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
 compile with:
 
 g++ -Wall main.cc -o editor
+
+run with -compile in a level directory to compile the
+collision, texture and entity maps into level.bin
 */
 
 
@@ -35,12 +38,58 @@ THE WORLD AS CHARACTERS, NEWLINE SEPERATED\n
 Entity map file format:
 
 THE ENTITIES AS CHARACTERS, NEWLINE SEPERATED\n
+
+Texture map file format (texture.map):
+
+THE TILE IDS AS CHARACTERS, NEWLINE SEPERATED\n
+
+The id is the character minus '0', so a texture map can only
+use ids 0 to 78 ('0' to '~'). Anything past that goes in a
+texture id map (texture.ids) instead, which is read in place
+of texture.map when it's there:
+
+THE TILE IDS AS DECIMAL NUMBERS (0 TO 65535), WHITESPACE
+SEPERATED, ONE ROW PER LINE\n
+
+Compiled level file format (level.bin), all words are
+little endian:
+
+header, 32 bit words:
+    magic ("SKLV") version width height chunk_size chunks_wide chunks_high
+    tile_id_count tile_id_offset spawn_count spawn_offset collision_offset
+the offset of each chunk, 32 bit words, by row
+the collision plane, starting on a 4096 byte boundary:
+    a collision bit for every tile, by row, lowest bit first,
+    each row padded out to a multiple of 64 bits
+the chunks, each one starting on a 4096 byte boundary:
+    chunk_size * chunk_size 16 bit tile ids, by row (0 for none)
+the tile ids the level uses, 16 bit words, starting on a 4096 byte boundary
+the spawns, 32 bit words: entity map character, x, y
+
+Tiles past the edge of the world are empty. The world
+header's width and height are only a byte each, so the
+compiler takes the size from the maps themselves.
 */
 
 
 #include <iostream>
 #include <fstream>
+#include <sstream>
 #include <string>
+#include <vector>
+#include <cstring>
+#include <cstdlib>
+
+
+const unsigned int LEVEL_MAGIC = 0x564c4b53;
+const unsigned int LEVEL_VERSION = 4;
+const int CHUNK_SIZE = 32;
+
+// the level file stores 16 bit tile ids
+const int MAX_TILE_ID = 0xffff;
+
+// the collision plane and each chunk get pages of their own, so the game can drop them when it's done with them
+const size_t CHUNK_ALIGNMENT = 4096;
 
 
 struct WorldHeader
@@ -147,8 +196,236 @@ bool create_entity_map(const WorldHeader& header)
 }
 
 
+bool read_map(const char* const filename, bool header, std::vector<std::string>* const rows)
+{
+    std::ifstream infile(filename);
+    if(!infile) {
+        std::cerr << "Couldn't open " << filename << std::endl;
+        return false;
+    }
+
+    std::string line;
+    if(header) getline(infile, line);
+
+    while(getline(infile, line)) {
+        if(!rows->empty() && line.length() != (*rows)[0].length()) {
+            std::cerr << "Uneven rows in " << filename << std::endl;
+            return false;
+        }
+        rows->push_back(line);
+    }
+
+    if(rows->empty() || (*rows)[0].empty()) {
+        std::cerr << filename << " is empty" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+
+bool read_tile_map(std::vector<std::vector<int> >* const rows)
+{
+    std::ifstream ids("texture.ids");
+    if(ids) {
+        std::string line;
+        while(getline(ids, line)) {
+            std::istringstream fields(line);
+            std::vector<int> row;
+
+            long id;
+            while(fields >> id) {
+                if(id < 0 || id > MAX_TILE_ID) {
+                    std::cerr << "Invalid tile, " << id << ", at " << row.size() << ", " << rows->size() << " in texture.ids" << std::endl;
+                    return false;
+                }
+                row.push_back(static_cast<int>(id));
+            }
+            if(!fields.eof()) {
+                std::cerr << "Invalid tile id in row " << rows->size() << " of texture.ids" << std::endl;
+                return false;
+            }
+
+            if(!rows->empty() && row.size() != (*rows)[0].size()) {
+                std::cerr << "Uneven rows in texture.ids" << std::endl;
+                return false;
+            }
+            rows->push_back(row);
+        }
+
+        if(rows->empty() || (*rows)[0].empty()) {
+            std::cerr << "texture.ids is empty" << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    std::vector<std::string> texture;
+    if(!read_map("texture.map", false, &texture)) return false;
+
+    for(size_t y=0; y<texture.size(); ++y) {
+        std::vector<int> row;
+        for(size_t x=0; x<texture[y].length(); ++x) {
+            // ids past '9' just keep going up the character set, as far as it's printable
+            const unsigned char c = static_cast<unsigned char>(texture[y][x]);
+            if(c < '0' || c > '~') {
+                std::cerr << "Invalid tile, " << texture[y][x] << ", at " << x << ", " << y
+                    << " (texture.map only goes from '0' to '~', use texture.ids for more tiles)" << std::endl;
+                return false;
+            }
+            row.push_back(c - '0');
+        }
+        rows->push_back(row);
+    }
+    return true;
+}
+
+
+void write_word(std::vector<unsigned char>* const out, unsigned int word)
+{
+    out->push_back(word & 0xff);
+    out->push_back((word >> 8) & 0xff);
+    out->push_back((word >> 16) & 0xff);
+    out->push_back((word >> 24) & 0xff);
+}
+
+
+void set_word(std::vector<unsigned char>* const out, size_t pos, unsigned int word)
+{
+    (*out)[pos] = word & 0xff;
+    (*out)[pos + 1] = (word >> 8) & 0xff;
+    (*out)[pos + 2] = (word >> 16) & 0xff;
+    (*out)[pos + 3] = (word >> 24) & 0xff;
+}
+
+
+bool compile_level()
+{
+    std::vector<std::string> collision, entity;
+    std::vector<std::vector<int> > texture;
+
+    std::cout << "Reading maps..." << std::endl;
+
+    if(!read_map("collision.map", true, &collision)) return false;
+    if(!read_tile_map(&texture)) return false;
+    if(!read_map("entity.map", false, &entity)) return false;
+
+    const int width = static_cast<int>(collision[0].length());
+    const int height = static_cast<int>(collision.size());
+    if(static_cast<int>(texture[0].size()) != width || static_cast<int>(texture.size()) != height
+        || static_cast<int>(entity[0].length()) != width || static_cast<int>(entity.size()) != height) {
+        std::cerr << "The maps aren't all the same size" << std::endl;
+        return false;
+    }
+
+    const int chunks_wide = (width + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    const int chunks_high = (height + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    const int chunk_tiles = CHUNK_SIZE * CHUNK_SIZE;
+
+    std::cout << "Compiling " << width << "x" << height << " world into "
+        << chunks_wide << "x" << chunks_high << " chunks..." << std::endl;
+
+    std::vector<unsigned char> out;
+    write_word(&out, LEVEL_MAGIC);
+    write_word(&out, LEVEL_VERSION);
+    write_word(&out, width);
+    write_word(&out, height);
+    write_word(&out, CHUNK_SIZE);
+    write_word(&out, chunks_wide);
+    write_word(&out, chunks_high);
+    for(int i=0; i<5; ++i) write_word(&out, 0);     /* the tables, filled in below */
+
+    const size_t index = out.size();
+    for(int i=0; i<chunks_wide * chunks_high; ++i) write_word(&out, 0);
+
+    // the game reads this straight into its collision grid at load, without touching the chunks
+    out.resize(((out.size() + CHUNK_ALIGNMENT - 1) / CHUNK_ALIGNMENT) * CHUNK_ALIGNMENT, 0);
+    set_word(&out, 44, out.size());
+    const size_t row_bytes = ((width + 63) / 64) * 8;
+    const size_t plane = out.size();
+    out.resize(plane + (row_bytes * height), 0);
+    for(int y=0; y<height; ++y) {
+        for(int x=0; x<width; ++x) {
+            if(collision[y][x] != '0') out[plane + (y * row_bytes) + (x / 8)] |= 1 << (x % 8);
+        }
+    }
+
+    std::vector<bool> used(MAX_TILE_ID + 1, false);
+    for(int cy=0; cy<chunks_high; ++cy) {
+        for(int cx=0; cx<chunks_wide; ++cx) {
+            out.resize(((out.size() + CHUNK_ALIGNMENT - 1) / CHUNK_ALIGNMENT) * CHUNK_ALIGNMENT, 0);
+            set_word(&out, index + (((cy * chunks_wide) + cx) * 4), out.size());
+
+            const size_t tiles = out.size();
+            out.resize(tiles + (chunk_tiles * 2), 0);
+
+            for(int i=0; i<chunk_tiles; ++i) {
+                const int x = (cx * CHUNK_SIZE) + (i % CHUNK_SIZE);
+                const int y = (cy * CHUNK_SIZE) + (i / CHUNK_SIZE);
+                if(x >= width || y >= height) continue;
+
+                const int id = texture[y][x];
+                used[id] = true;
+
+                out[tiles + (i * 2)] = id & 0xff;
+                out[tiles + (i * 2) + 1] = (id >> 8) & 0xff;
+            }
+        }
+    }
+
+    // the last chunk's padding
+    out.resize(((out.size() + CHUNK_ALIGNMENT - 1) / CHUNK_ALIGNMENT) * CHUNK_ALIGNMENT, 0);
+
+    set_word(&out, 32, out.size());
+    int tile_ids = 0;
+    for(int id=1; id<=MAX_TILE_ID; ++id) {
+        if(!used[id]) continue;
+        out.push_back(id & 0xff);
+        out.push_back((id >> 8) & 0xff);
+        ++tile_ids;
+    }
+    set_word(&out, 28, tile_ids);
+
+    // keep the spawn table word aligned
+    while(out.size() % 4) out.push_back(0);
+
+    set_word(&out, 40, out.size());
+    int spawns = 0;
+    for(int y=0; y<height; ++y) {
+        for(int x=0; x<width; ++x) {
+            if(entity[y][x] == '0') continue;
+            write_word(&out, entity[y][x]);
+            write_word(&out, x);
+            write_word(&out, y);
+            ++spawns;
+        }
+    }
+    set_word(&out, 36, spawns);
+
+    std::cout << tile_ids << " tiles, " << spawns << " spawns" << std::endl;
+
+    std::ofstream outfile("level.bin", std::ios::out | std::ios::binary);
+    if(!outfile) {
+        std::cerr << "Couldn't create compiled level file" << std::endl;
+        return false;
+    }
+
+    outfile.write(reinterpret_cast<const char*>(&out[0]), out.size());
+    if(!outfile) {
+        std::cerr << "Couldn't write compiled level file" << std::endl;
+        return false;
+    }
+    outfile.clear(); outfile.close();
+
+    std::cout << "Done!" << std::endl;
+    return true;
+}
+
+
 int main(int argc, char* argv[])
 {
+    if(argc > 1 && !strcmp(argv[1], "-compile"))
+        return compile_level() ? 0 : 1;
+
     struct WorldHeader header;
 
     std::cout << "Enter world width: " << std::flush;
@@ -0,0 +1,142 @@
+/**
+\file Animation.h
+\author Shane Lillie
+\brief Entity animation state header.
+
+\verbatim
+Copyright 2002-2003 Energon Software
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2, or (at your option)
+any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software Foundation,
+Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+\endverbatim
+*/
+
+
+#if !defined ANIMATION_H
+#define ANIMATION_H
+
+
+#include "shared.h"
+
+
+class Entity;
+
+
+/**
+\struct AnimationClip
+\brief A sequence of sprites played over time.
+
+The frames are stored as one sprite per tick, where the tick is the
+shortest frame duration in the clip, so the current frame is just
+ticks[seconds / tick_seconds]. Frame durations are rounded to a whole
+number of ticks.
+*/
+struct AnimationClip
+{
+    std::string name;
+    bool mirrored;
+    bool loop;
+
+    float tick_seconds, inverse_tick_seconds;
+    float length_seconds;
+
+    std::vector<int> ticks;
+
+    AnimationClip() : mirrored(false), loop(true), tick_seconds(0.0f), inverse_tick_seconds(0.0f), length_seconds(0.0f) {}
+};
+
+
+/**
+\class Animation
+\brief Structure-of-arrays store for the entity animation state.
+
+Every entity owns one slot in the store. The slot holds the clip the
+entity is playing, how far into it the entity is and the sprite that
+should be drawn. Awake slots (entities in the entity list that
+aren't frozen) are advanced together in one pass by advance(float).
+
+\note Slots are swap-removed, so an entity's slot can change when
+    another entity is released.
+*/
+class Animation
+{
+public:
+    /**
+    \brief Allocates a slot for an entity.
+    @param entity The entity that owns the slot.
+    @return The new slot.
+    @note The slot starts with no clip and no sprite.
+    */
+    static int allocate(Entity* const entity);
+
+    /**
+    \brief Frees an entity's slot.
+    @param slot The slot to free.
+    @note The last slot is moved into the freed one and its owner is told.
+    */
+    static void release(int slot);
+
+    /**
+    \brief Makes sure the store can hold count slots without growing.
+    @param count The number of slots.
+    */
+    static void reserve(int count);
+
+    /**
+    \brief Starts a clip playing.
+    @param slot The slot to play the clip in.
+    @param clip The clip to play.
+    @note If the clip is already playing, it isn't restarted.
+    */
+    static void play(int slot, const AnimationClip* const clip);
+
+    /**
+    \brief Stops any clip and shows a single sprite.
+    @param slot The slot to show the sprite in.
+    @param sprite The video index of the sprite.
+    */
+    static void show(int slot, int sprite);
+
+    /**
+    \brief Advances the clip of every awake slot.
+    @param dt The change in time in seconds.
+    */
+    static void advance(float dt);
+
+    /**
+    \brief Advances the clip of one slot.
+    @param slot The slot to advance.
+    @param dt The change in time in seconds.
+    */
+    static void advance(int slot, float dt);
+
+    /**
+    @return The number of allocated slots.
+    */
+    static int size()
+    {
+        return static_cast<int>(owner.size());
+    }
+
+public:
+    static std::vector<const AnimationClip*> clip;
+    static std::vector<float> seconds;
+    static std::vector<int> sprite;
+
+    static std::vector<unsigned char> awake;
+    static std::vector<Entity*> owner;
+};
+
+
+#endif
@@ -0,0 +1,181 @@
+/**
+\file Archetype.h
+\author Shane Lillie
+\brief Shared entity media header.
+
+\verbatim
+Copyright 2002-2003 Energon Software
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2, or (at your option)
+any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software Foundation,
+Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+\endverbatim
+*/
+
+
+#if !defined ARCHETYPE_H
+#define ARCHETYPE_H
+
+
+#include "shared.h"
+#include "Animation.h"
+
+
+struct VideoState;
+
+
+/**
+\class Archetype
+\brief The media shared by every entity of a class.
+
+An archetype is loaded (sprites scaled, flipped and color keyed) the
+first time an entity of its class asks for it, and every later entity
+of the class just gets a reference to the same archetype. Archetypes
+are reloaded if the video scale changes.
+*/
+class Archetype
+{
+public:
+    /**
+    \brief Fills in an archetype's sprites.
+    @param archetype The archetype to fill in.
+    @param video_state The video state.
+    */
+    typedef void (*Loader)(Archetype* const archetype, const VideoState& video_state);
+
+public:
+    /**
+    \brief Gets an archetype, loading it if it hasn't been loaded at the current scale.
+    @param name The name of the archetype (usually the entity class).
+    @param loader The function that loads the archetype.
+    @param video_state The video state.
+    @return The archetype.
+    @note The reference stays good until clear() is called, but the clips
+        in it are replaced if the archetype has to be reloaded.
+    */
+    static const Archetype& get(const std::string& name, Loader loader, const VideoState& video_state);
+
+    /**
+    \brief Forgets all of the archetypes.
+    @note Don't call this while any entities are still using an archetype.
+    */
+    static void clear();
+
+    /**
+    \brief Prints the archetype info.
+    @param out The output stream to print to.
+    */
+    static void print_archetypes(std::ostream& out);
+
+private:
+    static std::map<std::string, Archetype> archetypes;
+
+public:
+    /**
+    \brief Constructs an empty archetype.
+    */
+    Archetype();
+
+public:
+    /**
+    @param index The index of the sprite in the archetype.
+    @return The video index of the sprite.
+    @retval -1 The archetype doesn't have the sprite.
+    */
+    int sprite(int index) const
+    {
+        return (index >= 0 && index < static_cast<int>(m_sprites.size())) ? m_sprites[index] : -1;
+    }
+
+    /**
+    @return The number of sprites in the archetype.
+    */
+    int sprite_count() const
+    {
+        return static_cast<int>(m_sprites.size());
+    }
+
+    /**
+    @param sprite_index The video index of a sprite.
+    @return The index of the sprite in the archetype.
+    @retval -1 The sprite isn't in the archetype.
+    */
+    int find_sprite(int sprite_index) const;
+
+    /**
+    \brief Sets a sprite in the archetype.
+    @param index The index of the sprite in the archetype.
+    @param sprite_index The video index of the sprite.
+    */
+    void set_sprite(int index, int sprite_index);
+
+    /**
+    \brief Loads the animation clips and their frames.
+    @param directory The directory holding the clip file and the frame images.
+    @param width The width to make the frames.
+    @param height The height to make the frames.
+    @param video_state The video state.
+    @retval true The clips were loaded.
+    @retval false The clip file couldn't be loaded.
+
+    The clip file (directory/animation.clips) has one clip per line:
+    \verbatim
+    # name  loop|once  mirror|nomirror  frame seconds [frame seconds ...]
+    run     loop       mirror           run1 0.25 idle 0.25 run2 0.25 idle 0.25
+    \endverbatim
+    Each frame is loaded from directory/frame.tga, and mirrored clips also
+    get a horizontally flipped copy for entities facing the other way.
+    */
+    bool load_clips(const std::string& directory, int width, int height, const VideoState& video_state);
+
+    /**
+    @param name The name of the clip.
+    @param mirrored Whether the mirrored copy of the clip is wanted.
+    @return The clip.
+    @retval NULL The archetype doesn't have the clip.
+    */
+    const AnimationClip* clip(const std::string& name, bool mirrored) const;
+
+    /**
+    @param index The index of the clip in the archetype.
+    @return The clip.
+    @retval NULL The archetype doesn't have the clip.
+    */
+    const AnimationClip* clip(int index) const
+    {
+        return (index >= 0 && index < static_cast<int>(m_clips.size())) ? &m_clips[index] : NULL;
+    }
+
+    /**
+    @param clip A clip.
+    @return The index of the clip in the archetype.
+    @retval -1 The clip isn't one of the archetype's.
+    */
+    int find_clip(const AnimationClip* const clip) const;
+
+private:
+    int load_frame(const std::string& directory, const std::string& frame, bool mirrored, int width, int height, const VideoState& video_state);
+
+private:
+    std::string m_name;
+    float m_width_scale, m_height_scale;
+
+    std::vector<int> m_sprites;
+    std::map<std::string, int> m_frames;
+
+    /* clips are never added to after loading, so pointers to them stay good */
+    std::vector<AnimationClip> m_clips;
+};
+
+
+#endif
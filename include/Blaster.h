@@ -28,6 +28,7 @@ Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
 
 #include "shared.h"
 #include "Entity.h"
+#include "Pool.h"
 
 
 class Skratch;
@@ -53,9 +54,56 @@ public:
             DefaultHeight = 6
         };
 
+        enum
+        {
+            // the number of shots to allocate at a time
+            PoolChunkSize = 8
+        };
+
         static const std::string ANIMATION_FILENAME;
         static const float HORIZONTAL_VEL;
 
+    public:
+        /**
+        \brief Allocates a shot from the shot pool.
+        @param size The size of the object.
+        */
+        static void* operator new(size_t size);
+
+        /**
+        \brief Returns a shot to the shot pool.
+        @param p The shot.
+        @param size The size of the object.
+        */
+        static void operator delete(void* p, size_t size);
+
+        /**
+        \brief Makes sure the shot pool can hold count shots without growing.
+        @param count The number of shots.
+        */
+        static void reserve(size_t count);
+
+        /**
+        @return The number of shots the shot pool can hold without growing.
+        */
+        static size_t capacity()
+        {
+            return pool.capacity();
+        }
+
+        /**
+        \brief Looks up the shot archetype ahead of time, so shooting doesn't.
+        @param video_state The video state.
+        @note The blaster does this when it loads, and again for every level, so Archetype::clear() is covered.
+        */
+        static void load_shared_media(const VideoState& video_state);
+
+    private:
+        static Pool<BlasterShot> pool;
+        static const Archetype* archetype;  /* set by load_shared_media() */
+
+        static void load_archetype(Archetype* const archetype, const VideoState& video_state);
+
     public:
         /**
         \brief Constructs a new BlasterShot.
@@ -64,12 +112,24 @@ public:
         */
         BlasterShot(const Skratch& skratch, const World& world);
 
+    public:
+        /**
+        \brief Sets up the shot's media from the archetype load_shared_media() found.
+        @param video_state The video state, in case the archetype hasn't been looked up yet.
+        @note This does the same as load_media(), without looking anything up.
+        */
+        void use_shared_media(const VideoState& video_state);
+
     public:
         virtual void think(const World& world);
         virtual void load_sprites(const VideoState& video_state);
 
     private:
         virtual void on_animate(float dt, const std::bitset<World::CollisionSize>& collision_types, const World& world);
+
+    private:
+        // the per-class entity loops call on_animate() directly
+        friend class Entity;
     };
 
 private:
@@ -79,11 +139,19 @@ private:
         DefaultHeight = 16
     };
 
+    enum
+    {
+        MaxShots = 8
+    };
+
     static const std::string ANIMATION_FILENAME;
     static const std::string SHOOT_SOUND_FILENAME;
 
     static const float COOL_TIME;
 
+private:
+    static void load_archetype(Archetype* const archetype, const VideoState& video_state);
+
 public:
     /**
     \brief Constructs a new Blaster item.
@@ -106,6 +174,23 @@ public:
     */
     void lower_cool_time(float dt);
 
+    /**
+    @return How long until the blaster can shoot again, in seconds.
+    */
+    float cool_time() const
+    {
+        return m_cool_time;
+    }
+
+    /**
+    \brief Sets the cool down time.
+    @param cool_time How long until the blaster can shoot again, in seconds.
+    */
+    void set_cool_time(float cool_time)
+    {
+        m_cool_time = cool_time;
+    }
+
 public:
     virtual void think(const World& world);
     virtual void load_sprites(const VideoState& video_state);
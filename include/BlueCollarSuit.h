@@ -57,36 +57,50 @@ private:
 
     enum
     {
-        IdleLeftAnimation,
-        IdleRightAnimation,
-        Run1LeftAnimation,
-        Run2LeftAnimation,
-        Run1RightAnimation,
-        Run2RightAnimation,
-
-        // this should match the number of animations
-        AnimationCount = 6
+        // this should match the number of sounds
+        SoundCount = 0
     };
 
     enum
     {
-        // this should match the number of sounds
-        SoundCount = 0
+        // how many thinks to follow a path before looking for a new one
+        ReplanThinks = 30
     };
 
-    static const std::string IDLE_ANIMATION_FILENAME;
-    static const std::string RUN1_ANIMATION_FILENAME;
-    static const std::string RUN2_ANIMATION_FILENAME;
+    static const std::string ANIMATION_DIRECTORY;
+    static const std::string IDLE_CLIP;
+    static const std::string RUN_CLIP;
 
     static const float MASS;
     static const float MAX_HORIZONTAL_VEL;
     static const float HORIZONTAL_ACCEL;
+    static const float JUMP_VEL;
+
+public:
+    /**
+    \brief Registers the suit's handlers with the entity collision table.
+    */
+    static void register_collision_handlers();
+
+    /**
+    \brief Gets what the world's navigation graph has to be built for.
+    @param video_state The video state.
+    @return The suit's size and movement.
+    */
+    static NavGraph::Mover navigation_mover(const VideoState& video_state);
+
+private:
+    static void on_projectile_collision(Entity* const entity, Entity* const projectile);
+    static void load_archetype(Archetype* const archetype, const VideoState& video_state);
 
 public:
     /**
     \brief Constructs a BlueCollarSuit object.
     */
     BlueCollarSuit();
+    virtual ~BlueCollarSuit() throw()
+    {
+    }
 
 public:
     virtual void think(const World& world);
@@ -95,18 +109,29 @@ public:
 
 private:
     virtual void on_animate(float dt, const std::bitset<World::CollisionSize>& collision_types, const World& world);
-    virtual void on_collision(Entity* const entity);
     virtual void set_state(int state);
 
+    // accelerates toward a column of pixels, or stops if already there
+    void run_toward(float x);
+
 private:
-    int m_sprite_indexes[AnimationCount];
 //    int m_sound_indexes[SoundCount];
 
     BlueCollarSuitState m_state;
+    bool m_on_ground;
+
+    /* chasing skratch through the world's navigation graph */
+    NavGraph::Search m_search;
+    std::vector<int> m_path;
+    size_t m_path_step;
+    int m_replan;
 
 private:
     BlueCollarSuit(const BlueCollarSuit& skratch) {}
     const BlueCollarSuit& operator=(const BlueCollarSuit& rhs) { return *this; }
+private:
+    // the per-class entity loops call on_animate() directly
+    friend class Entity;
 };
 
 
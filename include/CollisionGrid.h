@@ -0,0 +1,145 @@
+/**
+\file CollisionGrid.h
+\author Shane Lillie
+\brief Bit packed collision grid header.
+
+\verbatim
+Copyright 2002-2003 Energon Software
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2, or (at your option)
+any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software Foundation,
+Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+\endverbatim
+*/
+
+
+
+#if !defined COLLISIONGRID_H
+#define COLLISIONGRID_H
+
+
+#include "shared.h"
+
+
+/**
+\class CollisionGrid
+\brief One bit per tile for whether the tile is collidable.
+
+Every row of tiles is packed into 64 bit words, lowest bit first, so a
+horizontal run of tiles is tested a word at a time with a mask instead
+of a tile at a time. A coarser grid keeps one bit per 8x8 block of
+tiles that's set if anything in the block is collidable, so rectangles
+with nothing in them are thrown out without looking at every row.
+
+Tiles outside of the grid are never collidable.
+*/
+class CollisionGrid
+{
+public:
+    enum
+    {
+        SummarySize = 8     /* tiles on a side of a summary block */
+    };
+
+public:
+    /**
+    \brief Constructs an empty grid.
+    */
+    CollisionGrid();
+
+public:
+    /**
+    \brief Resizes the grid and clears every tile.
+    @param width The width in tiles.
+    @param height The height in tiles.
+    */
+    void resize(int width, int height);
+
+    /**
+    \brief Sets a whole row at once.
+    @param y The row.
+    @param bits The tiles, lowest bit first, padded out to a whole number of 64 bit words.
+    @note update_summary() has to be called once the tiles are all set.
+    */
+    void set_row(int y, const byte* const bits);
+
+    /**
+    \brief Sets one tile and keeps the summary up to date.
+    @param x The column of the tile.
+    @param y The row of the tile.
+    @param collidable Whether the tile is collidable.
+    */
+    void set(int x, int y, bool collidable);
+
+    /**
+    \brief Rebuilds the 8x8 block summary from the tiles.
+    */
+    void update_summary();
+
+    /**
+    @return A hash of every tile, for telling whether something built from the grid is still good.
+    */
+    unsigned int hash() const;
+
+    /**
+    @return The number of collidable tiles in [x0, x1] on row y.
+    */
+    int count(int y, int x0, int x1) const;
+
+    /**
+    @return The first collidable tile in [x0, x1] on row y.
+    @retval -1 There aren't any.
+    */
+    int first(int y, int x0, int x1) const;
+
+    /**
+    @return Whether anything in the rectangle [x0, x1] x [y0, y1] is collidable.
+    */
+    bool any(int x0, int y0, int x1, int y1) const;
+
+public:
+    /**
+    @return Whether the tile at (x, y) is collidable.
+    */
+    bool test(int x, int y) const
+    {
+        if(x < 0 || y < 0 || x >= m_width || y >= m_height) return false;
+        return 0 != ((m_bits[(y * m_words) + (x >> 6)] >> (x & 63)) & 1);
+    }
+
+    /**
+    @return Whether anything in [x0, x1] on row y is collidable.
+    */
+    bool any(int y, int x0, int x1) const
+    {
+        return first(y, x0, x1) >= 0;
+    }
+
+    int width() const { return m_width; }
+    int height() const { return m_height; }
+
+private:
+    static int span_first(const std::vector<Uint64>& bits, int words, int y, int x0, int x1);
+
+private:
+    int m_width, m_height;
+    int m_words;                    /* per row */
+    std::vector<Uint64> m_bits;
+
+    int m_summary_width, m_summary_height;
+    int m_summary_words;            /* per summary row */
+    std::vector<Uint64> m_summary;
+};
+
+
+#endif
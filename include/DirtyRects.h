@@ -0,0 +1,116 @@
+/**
+\file DirtyRects.h
+\author Shane Lillie
+\brief Dirty rectangle tracking header.
+
+\verbatim
+Copyright 2002-2003 Energon Software
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2, or (at your option)
+any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software Foundation,
+Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+\endverbatim
+*/
+
+
+#if !defined DIRTYRECTS_H
+#define DIRTYRECTS_H
+
+
+#include "shared.h"
+#include "Vector.h"
+
+
+/**
+\class DirtyRects
+\brief The parts of the window that changed since the last frame.
+
+While the camera is parked, the only things that change on screen are
+the sprites and the text drawn over the world. Those are recorded as
+they're drawn (see Video::set_dirty_rects()), and the next frame only
+has to put the world back under where they were, draw them again, and
+present the areas they covered in either frame.
+
+Anything that moves the camera, or damage over too much of the window,
+makes the frame a full redraw instead.
+*/
+class DirtyRects
+{
+public:
+    enum
+    {
+        // past this percentage of the window, the whole window is presented
+        MaxDirtyPercent = 40
+    };
+
+public:
+    /**
+    \brief Constructs a tracker that starts with a full redraw.
+    */
+    DirtyRects();
+
+public:
+    /**
+    \brief Makes the next frame a full redraw.
+    */
+    void invalidate() { m_valid = false; }
+
+    /**
+    \brief Starts a frame.
+    @param camera The world position of the window this frame.
+    @retval true The whole window has to be redrawn.
+    @retval false Only the damaged() areas have to be redrawn.
+    */
+    bool begin_frame(const Vector<int>& camera);
+
+    /**
+    \brief Records an area drawn on the window this frame.
+    @param rect The area, which is clipped to the window.
+    */
+    void add(const SDL_Rect& rect);
+
+    /**
+    \brief Shows the frame, either the changed areas or the whole window.
+    */
+    void present();
+
+public:
+    /**
+    @return The areas drawn over last frame, which have to be redrawn under this frame's sprites.
+    */
+    const std::vector<SDL_Rect>& damaged() const { return m_damaged; }
+
+    /**
+    @return Whether this frame is a full redraw.
+    */
+    bool full() const { return m_full; }
+
+private:
+    // joins overlapping rects until none overlap
+    static void merge(std::vector<SDL_Rect>* const rects);
+
+    static int area(const std::vector<SDL_Rect>& rects);
+
+private:
+    bool m_valid;
+    bool m_full;
+    Vector<int> m_camera;
+    int m_window_width, m_window_height;
+
+    std::vector<SDL_Rect> m_drawn;      /* this frame's sprites, next frame's damage */
+    std::vector<SDL_Rect> m_damaged;    /* last frame's sprites */
+    std::vector<SDL_Rect> m_present;    /* scratch for present() */
+};
+
+
+#endif
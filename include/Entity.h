@@ -28,33 +28,122 @@ Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
 
 
 #include "shared.h"
+#include "Animation.h"
+#include "Archetype.h"
+#include "Physics.h"
+#include "SlotMap.h"
+#include "TypeList.h"
 #include "World.h"
 
 
 class Audio;
+class SpatialHash;
 struct VideoState;
 
 
 class Entity
 {
+public:
+    /**
+    \enum CollisionLayer
+    \brief The layers entities collide on.
+    */
+    enum CollisionLayer
+    {
+        PlayerLayer,
+        EnemyLayer,
+        ProjectileLayer,
+        PickupLayer,
+
+        // this should be the # of collision layers
+        CollisionLayerCount = 4
+    };
+
+    /**
+    \brief Handles a collision between two entities.
+    @param entity The entity being animated.
+    @param other The entity it collided with.
+    @note The handler can assume the entities are of the classes on its layers.
+    */
+    typedef void (*CollisionHandler)(Entity* const entity, Entity* const other);
+
+    /**
+    \brief Refers to an entity in the entity list.
+    @note A handle goes stale once its entity is removed, so it's safe to hold on to.
+    */
+    typedef SlotMap<Entity*>::Handle Handle;
+
+    /**
+    \brief Sets the function that handles collisions between two layers.
+    @param layer The layer of the entity being animated.
+    @param other The layer of the entity it collided with.
+    @param handler The handler, or NULL to ignore collisions between the layers.
+    @note Collisions are only tested when there's a handler for them.
+    */
+    static void set_collision_handler(CollisionLayer layer, CollisionLayer other, CollisionHandler handler);
+
+    /**
+    @return The mask bit for a collision layer.
+    */
+    static unsigned int layer_bit(CollisionLayer layer)
+    {
+        return 1U << layer;
+    }
+
+public:
+    /**
+    \enum ActivityTier
+    \brief How much simulation an entity gets, by its distance from the camera.
+    */
+    enum ActivityTier
+    {
+        ActiveTier,     /* thinks and animates every frame */
+        WarmTier,       /* thinks and animates once every few frames */
+        FrozenTier,     /* isn't touched at all */
+
+        // this should be the # of activity tiers
+        ActivityTierCount = 3
+    };
+
+    /**
+    \brief Sets up the activity regions around the camera.
+    @param active_blocks How far past the window (in blocks) entities are active.
+    @param warm_blocks How far past the window (in blocks) entities are warm.
+    @param hysteresis_blocks How far past the edge of its region (in blocks) an entity has to get before it drops to a lower tier.
+    @param warm_interval Warm entities are simulated once every this many frames.
+    */
+    static void set_activity_regions(int active_blocks, int warm_blocks, int hysteresis_blocks, int warm_interval);
+
+    /**
+    @param tier The activity tier.
+    @return The number of entities that were in the tier last frame.
+    */
+    static int activity_count(ActivityTier tier)
+    {
+        return activity_counts[tier];
+    }
+
 public:
     /**
     \brief Adds an entity.
     @param entity The entity to add.
     @note This doesn't copy the entity, it just adds the pointer.
     @note The entity must have been created with new.
+    @return The entity's handle.
     */
-    static void push_back(Entity* const entity);
+    static Handle push_back(Entity* const entity);
 
     /**
-    @return The last entity.
-    @retval NULL There are no entities.
+    @return The entity the handle refers to.
+    @retval NULL The entity has been removed (or was never added).
     */
-    static Entity* const back();
+    static Entity* const get(const Handle& handle);
 
     /**
     \brief Causes all entities to think.
     @param world The game world.
+    @note This also sorts the entities into their activity tiers for the frame.
+    @note If the worker pool is running, the entities are split between the workers.
     */
     static void all_think(const World& world);
 
@@ -63,6 +152,8 @@ public:
     \brief Animates all of the entities.
     @param dt The change in time in seconds.
     @param world The game world.
+    @note If the worker pool is running, the integration is split between the workers.
+        The collisions are always resolved on the calling thread.
     */
     static void all_animate(float dt, const World& world);
 
@@ -71,14 +162,10 @@ public:
     */
     static void cleanup();
 
-    /**
-    \brief Sorts the entities.
-    */
-    static void sort();
-
     /**
     \brief Renders all entities.
     @param world The game world.
+    @note Entities are drawn by draw layer (lowest first), then in the order they were added to the layer.
     */
     static void render_entities(const World& world);
 
@@ -87,17 +174,150 @@ public:
     */
     static void free_entities();
 
+    /**
+    \brief Keeps removed entities around for a while so a rewind can bring them back.
+    @param frames How many cleanups to keep a removed entity for. 0 deletes it right away.
+    @param frames_per_second How many cleanups the game does a second.
+    */
+    static void set_graveyard_frames(int frames, int frames_per_second);
+
+    /**
+    @return How many seconds a removed entity is kept for.
+    */
+    static float graveyard_seconds()
+    {
+        return static_cast<float>(graveyard_frames) / graveyard_frames_per_second;
+    }
+
+    /**
+    \brief Makes room in the entity stores for more entities of a class, so adding them doesn't allocate.
+    @param count How many more entities of the class there could be.
+    @note The room is on top of the entities there are now, so do this after the level's entities are spawned.
+    */
+    template <class T>
+    static void reserve(size_t count)
+    {
+        reserve_stores(count);
+
+        SlotMap<T*>& list = TypedEntities<T>::entities;
+        list.reserve(list.size() + count);
+    }
+
+    /**
+    \brief Appends the state of every entity to a frame.
+    @param frame The frame to append to.
+    @note This covers the physics, animation and removal state,
+        but not anything the sub-classes keep for themselves.
+    @note Entities are written as their id(), and clips and sprites as their index
+        in the entity's archetype, so the frame doesn't hold any pointers.
+    */
+    static void save_state(std::vector<unsigned char>* const frame);
+
+    /**
+    \brief Puts every entity back the way save_state() found it.
+    @param frame The frame.
+    @param offset Where save_state() started appending to the frame.
+    @retval true The state was restored.
+    @retval false The frame was too short.
+    @note Entities removed since the frame are brought back from the graveyard,
+        and entities added since are removed.
+    @note This must be called between frames, after cleanup().
+    */
+    static bool load_state(const std::vector<unsigned char>& frame, size_t offset);
+
     /**
     \brief Prints the entity info.
     @param out The output stream to print to.
     */
     static void print_entities(std::ostream& out);
 
+    /**
+    @return The number of entity pairs the broadphase passed to the narrow test last frame.
+    */
+    static unsigned long collision_pairs_tested()
+    {
+        return pairs_tested;
+    }
+
 private:
     static bool collision(const Entity& a, const Entity& b);
+    static void update_activity(const World& world);
+
+    static void integrate_chunk(int begin, int end, int chunk, const void* data);
+    static void apply_commands();
+    static void reserve_stores(size_t count);
+    static void mark_removed(Entity* const entity);
+    static void unlist(Entity* const entity);
+    static void revive(Entity* const entity);
+
+    /* the per-class loops, walked over EntityTypes in Entity.cc */
+    static void think_types(const World& world, NullType) { }
+    template <class H, class T> static void think_types(const World& world, TypeList<H, T>);
+    template <class T> static void think_type(const World& world);
+    template <class T> static void think_chunk(int begin, int end, int chunk, const void* data);
+
+    static void resolve_types(const World& world, NullType) { }
+    template <class H, class T> static void resolve_types(const World& world, TypeList<H, T>);
+    template <class T> static void resolve_type(const World& world);
+
+    template <class T> static void release_type(const SlotHandle& handle)
+    {
+        TypedEntities<T>::entities.erase(handle);
+    }
+
+    template <class T> static SlotHandle list_type(Entity* const entity)
+    {
+        return TypedEntities<T>::entities.insert(static_cast<T*>(entity));
+    }
+
+private:
+    /* the listed entities of one concrete class */
+    template <class T>
+    struct TypedEntities
+    {
+        static SlotMap<T*> entities;
+    };
+
+private:
+    /* a change to an entity made from a worker thread */
+    struct Command
+    {
+        enum Type
+        {
+            Remove
+        };
+
+        Type type;
+        Entity* entity;
+
+        Command(Type t, Entity* const e) : type(t), entity(e)
+        {
+        }
+    };
 
 private:
-    static std::list<Entity*> entities;
+    static SlotMap<Entity*> entities;
+    static std::vector<Entity*> removed;
+
+    /* removed entities waiting to be deleted, and the cleanup they were removed on */
+    static std::deque<std::pair<unsigned int, Entity*> > graveyard;
+    static unsigned int graveyard_frames, graveyard_frames_per_second, cleanup_frame;
+    static std::map<int, std::vector<Entity*> > draw_layers;
+
+    static CollisionHandler collision_handlers[CollisionLayerCount][CollisionLayerCount];
+
+    static SpatialHash broadphase;
+    static std::vector<Entity*> candidates;
+    static unsigned long pairs_tested;
+    static unsigned long pairs_possible;
+
+    static int active_blocks, warm_blocks, hysteresis_blocks, warm_interval;
+    static unsigned int activity_frame, next_activity_phase;
+    static unsigned int next_id;
+    static int activity_counts[ActivityTierCount];
+
+    /* one buffer per worker chunk, applied in chunk order */
+    static std::vector<std::vector<Command> > commands;
 
 public:
     /**
@@ -109,9 +329,7 @@ public:
     /**
     \brief Destroys the entity object.
     */
-    virtual ~Entity() throw()
-    {
-    }
+    virtual ~Entity() throw();
 
 public:
     // loads all of the entities media (sounds, sprites, etc.)
@@ -171,7 +389,13 @@ public:
     */
     void set_position(const Vector<float>& position)
     {
-        m_position = position;
+        Physics::position_x[m_physics_slot] = position.x();
+        Physics::position_y[m_physics_slot] = position.y();
+        Physics::position_z[m_physics_slot] = position.z();
+
+        // the draw layer is the integer part of z
+        if(static_cast<int>(position.z()) != m_draw_layer)
+            set_draw_layer(static_cast<int>(position.z()));
     }
 
     /**
@@ -180,7 +404,8 @@ public:
     */
     void set_velocity(const Vector<float>& velocity)
     {
-        m_velocity = velocity;
+        Physics::velocity_x[m_physics_slot] = velocity.x();
+        Physics::velocity_y[m_physics_slot] = velocity.y();
     }
 
     /**
@@ -189,7 +414,8 @@ public:
     */
     void set_acceleration(const Vector<float>& acceleration)
     {
-        m_acceleration = acceleration;
+        Physics::acceleration_x[m_physics_slot] = acceleration.x();
+        Physics::acceleration_y[m_physics_slot] = acceleration.y();
     }
 
     /**
@@ -198,40 +424,66 @@ public:
     */
     void accelerate(const Vector<float>& acceleration)
     {
-        m_acceleration += acceleration;
+        Physics::acceleration_x[m_physics_slot] += acceleration.x();
+        Physics::acceleration_y[m_physics_slot] += acceleration.y();
     }
 
     /**
     @return The entity's position.
     */
-    const Vector<float>& position() const
+    Vector<float> position() const
     {
-        return m_position;
+        return Vector<float>(Physics::position_x[m_physics_slot], Physics::position_y[m_physics_slot], Physics::position_z[m_physics_slot]);
     }
 
     /**
     @return The entity's velocity.
     */
-    const Vector<float>& velocity() const
+    Vector<float> velocity() const
     {
-        return m_velocity;
+        return Vector<float>(Physics::velocity_x[m_physics_slot], Physics::velocity_y[m_physics_slot], 0.0f);
     }
 
     /**
-    \brief Marks the entity to be removed.
+    @return The entity's acceleration.
     */
-    void set_removable()
+    Vector<float> acceleration() const
     {
-        m_removable = true;
+        return Vector<float>(Physics::acceleration_x[m_physics_slot], Physics::acceleration_y[m_physics_slot], 0.0f);
     }
 
+    /**
+    \brief Marks the entity to be removed.
+    @note On a worker thread this is put off until the workers are done.
+    */
+    void set_removable();
+
     /**
     @retval true The entity will be removed on cleanup.
     @retval false The entity will not be removed on cleanup.
     */
     bool removable() const
     {
-        return m_removable;
+        return (Physics::flags[m_physics_slot] & Physics::Removed) != 0;
+    }
+
+    /**
+    @return The entity's handle.
+    @note Entities that aren't in the entity list have a handle that never refers to anything.
+    */
+    const Handle& handle() const
+    {
+        return m_handle;
+    }
+
+    /**
+    @return The entity's id.
+    @note Ids count up from 0 as entities are constructed, and unlike the handle,
+        an entity keeps its id when a rewind brings it back.
+    */
+    unsigned int id() const
+    {
+        return m_id;
     }
 
 public:
@@ -243,7 +495,59 @@ public:
     */
     friend bool operator<(const Entity& lhs, const Entity& rhs);
 
+private:
+    /**
+    \brief Moves the entity to the end of another draw layer.
+    @param layer The new draw layer.
+    */
+    void set_draw_layer(int layer);
+
+    /**
+    \brief Takes the entity out of its draw layer.
+    */
+    void remove_from_draw_layer();
+
+    /**
+    \brief Adds the entity to the broadphase.
+    @note The bounds cover both where the entity is and where it's headed this frame.
+    @note This must be called after the entity has been integrated.
+    */
+    void insert_broadphase();
+
+    /**
+    \brief Resolves the integrated motion against the world and other entities.
+    @param dt The change in time in seconds.
+    @param world The game world.
+    @return A bitset containing the types of world collisions that occurred.
+    @note The caller passes the collisions on to on_animate().
+    */
+    std::bitset<World::CollisionSize> resolve(float dt, const World& world);
+
 protected:
+    /**
+    \brief Lists the entity with the other entities of its class.
+    @param entity The entity, as its concrete class.
+    @note Every class in EntityTypes calls this from its constructor.
+    @note This does nothing if the entity isn't in the entity list.
+    */
+    template <class T>
+    void set_type(T* const entity)
+    {
+        if(!entities.contains(m_handle)) return;
+
+        m_type_handle = TypedEntities<T>::entities.insert(entity);
+        m_list_type = list_type<T>;
+        m_release_type = release_type<T>;
+    }
+
+protected:
+    /**
+    \brief Aborts if this is a worker thread.
+    @note The slot stores and the entity pools aren't thread safe, so a class with its
+        own operator new calls this before it takes anything from its pool.
+    */
+    static void check_main_thread();
+
     /**
     \brief Loads a sprite for the entity.
     @param filename The file to load.
@@ -253,7 +557,65 @@ protected:
     @return The index of the sprite.
     @note This will scale width and height by the video scale factor, so don't do it to the arguments.
     */
-    int load_sprite(const std::string& filename, int width, int height, const VideoState& video_state);
+    static int load_sprite(const std::string& filename, int width, int height, const VideoState& video_state);
+
+    /**
+    \brief Points the entity at its class archetype, loading the archetype if need be.
+    @param name The name of the archetype.
+    @param loader The function that loads the archetype.
+    @param video_state The video state.
+    */
+    void use_archetype(const std::string& name, Archetype::Loader loader, const VideoState& video_state);
+
+    /**
+    \brief Points the entity at an archetype that was already looked up.
+    @param archetype The archetype.
+    */
+    void use_archetype(const Archetype& archetype)
+    {
+        m_archetype = &archetype;
+    }
+
+    /**
+    \brief Gives the entity a body if it's showing a sprite.
+    @note load_media() does this, so it's only needed when the media is set up some other way.
+    */
+    void enable_body();
+
+    /**
+    @param index The index of the sprite in the entity's archetype.
+    @return The video index of the sprite.
+    @retval -1 The entity has no archetype or the archetype doesn't have the sprite.
+    */
+    int sprite(int index) const
+    {
+        return m_archetype ? m_archetype->sprite(index) : -1;
+    }
+
+    /**
+    \brief Plays one of the archetype's animation clips.
+    @param clip The name of the clip.
+    @param mirrored Whether to play the mirrored copy of the clip.
+    @note If the clip is already playing, it keeps going from where it is.
+    */
+    void play(const std::string& clip, bool mirrored);
+
+    /**
+    \brief Stops the animation and shows a single sprite.
+    @param sprite_index The video index of the sprite.
+    */
+    void show(int sprite_index)
+    {
+        Animation::show(m_animation_slot, sprite_index);
+    }
+
+    /**
+    @return The video index of the sprite being shown.
+    */
+    int current_sprite() const
+    {
+        return Animation::sprite[m_animation_slot];
+    }
 
 protected:
     /**
@@ -269,24 +631,60 @@ protected:
     */
     virtual void on_animate(float dt, const std::bitset<World::CollisionSize>& collision_types, const World& world) { }
 
+protected:
     /**
-    \brief Called when an entity collision occurs.
-    @param entity The entity that this entity collided with.
+    \brief Puts the entity on a collision layer.
+    @param layer The layer the entity is on.
+    @param mask The layer bits (see layer_bit()) the entity collides with.
+    @note Two entities are only tested for collision if each one's mask has the other's layer.
     */
-    virtual void on_collision(Entity* const entity) { }
+    void set_collision_layer(CollisionLayer layer, unsigned int mask)
+    {
+        m_collision_layer = layer;
+        m_collision_mask = mask;
+    }
 
 protected:
-    Vector<float> m_position;
-    Vector<float> m_velocity;
-    Vector<float> m_acceleration;
+    /* component-wise access to the physics state for the sub-classes */
+    void set_position_x(float x) { Physics::position_x[m_physics_slot] = x; }
+    void set_position_y(float y) { Physics::position_y[m_physics_slot] = y; }
+    void set_velocity_x(float x) { Physics::velocity_x[m_physics_slot] = x; }
+    void set_velocity_y(float y) { Physics::velocity_y[m_physics_slot] = y; }
+    void add_velocity_y(float y) { Physics::velocity_y[m_physics_slot] += y; }
+    void set_acceleration_x(float x) { Physics::acceleration_x[m_physics_slot] = x; }
+    void set_acceleration_y(float y) { Physics::acceleration_y[m_physics_slot] = y; }
+    void set_mass(float mass) { Physics::mass[m_physics_slot] = mass; }
+
+private:
+    unsigned int m_id;
+
+    Handle m_handle;
+    SlotHandle m_type_handle;
+    SlotHandle (*m_list_type)(Entity* const entity);
+    void (*m_release_type)(const SlotHandle& handle);
 
-    int m_current_sprite_index;
+    const Archetype* m_archetype;
 
-    float m_animation_seconds, m_mass;
+    int m_animation_slot;
+    int m_physics_slot;
+
+    ActivityTier m_activity;
+    unsigned int m_activity_phase;
+
+    int m_draw_layer;
+    bool m_drawn;
+
+    CollisionLayer m_collision_layer;
+    unsigned int m_collision_mask;
 
 private:
-    bool m_removable;
+    friend class Animation;
+    friend class Physics;
 };
 
 
+template <class T>
+SlotMap<T*> Entity::TypedEntities<T>::entities;
+
+
 #endif
@@ -0,0 +1,52 @@
+/**
+\file EntityTypes.h
+\author Shane Lillie
+\brief Concrete entity class list header.
+
+\verbatim
+Copyright 2002-2003 Energon Software
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2, or (at your option)
+any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software Foundation,
+Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+\endverbatim
+*/
+
+
+#if !defined ENTITYTYPES_H
+#define ENTITYTYPES_H
+
+
+#include "shared.h"
+#include "Blaster.h"
+#include "BlueCollarSuit.h"
+#include "Skratch.h"
+#include "TypeList.h"
+
+
+/**
+\brief Every concrete entity class.
+
+The entity loops run once per class in this list, so each loop only
+sees one class and calls it directly instead of through the vtable.
+A new entity class has to go in here and call Entity::set_type() from
+its constructor, or it won't think or animate.
+*/
+typedef TypeList<Skratch,
+        TypeList<BlueCollarSuit,
+        TypeList<Blaster,
+        TypeList<Blaster::BlasterShot,
+        NullType> > > > EntityTypes;
+
+
+#endif
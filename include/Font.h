@@ -45,7 +45,8 @@ public:
     bool load(const std::string& filename, const VideoState& video_state);
 
     // renders the text on the destination surface at position
-    void render_text(const std::string& text, SDL_Surface* const destination, int x, int y) const;
+    // returns the area of the destination the text covers
+    SDL_Rect render_text(const std::string& text, SDL_Surface* const destination, int x, int y) const;
 
 public:
     bool loaded() const { return m_surface_index >= 0; }
@@ -0,0 +1,254 @@
+/**
+\file LevelFile.h
+\author Shane Lillie
+\brief Compiled level header.
+
+\verbatim
+Copyright 2002-2003 Energon Software
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2, or (at your option)
+any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software Foundation,
+Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+\endverbatim
+*/
+
+
+
+#if !defined LEVELFILE_H
+#define LEVELFILE_H
+
+
+#include "shared.h"
+#include "MappedFile.h"
+
+
+/**
+\class LevelFile
+\brief A compiled level (level.bin, written by editor -compile), used in place.
+
+The file is mapped into memory and the tiles are read straight out of
+the mapping, so loading a level doesn't read or parse anything but the
+header and index. All of the words in the file are little endian.
+
+The header is twelve 32 bit words: the magic number, the version, the
+width and height of the level in tiles, the chunk size, the number of
+chunks across and down, the number of tile ids used and where their
+table starts, the number of spawns and where their table starts, and
+where the collision plane starts. The chunk index follows with the
+offset of every chunk, by row.
+
+The collision plane is one bit per tile for the whole level, by row,
+lowest bit first, with every row padded out to a whole number of 64
+bit words. It's kept apart from the chunks so the collision map can be
+read in one pass at load without touching any of the tiles.
+
+A chunk is a square of chunk_size() tiles on a side. It holds a 16 bit
+tile id for every tile, by row (0 for no tile). The tile table is every
+tile id the level uses as 16 bit words, and a spawn is three 32 bit
+words: the entity map character and the tile it's at.
+
+The collision plane and every chunk start on a ChunkAlignment boundary
+and the space up to the next one is padding, so a chunk's pages aren't shared with any
+other chunk's.
+
+The loader thread touches the pages of the chunks it's asked for, so
+the page faults happen there instead of in the middle of a frame, and
+release() hands a chunk's pages back to the system once it's out of
+range.
+
+\note Nothing here uses ENTER_FUNCTION on the loader thread, since the
+    call stack tracking isn't thread safe.
+*/
+class LevelFile
+{
+public:
+    enum
+    {
+        Magic = 0x564c4b53,     /* "SKLV" */
+        Version = 4,
+
+        HeaderWords = 12,
+
+        // chunks start on this boundary and are padded out to it, so each one owns whole pages
+        ChunkAlignment = 4096
+    };
+
+public:
+    /**
+    \brief Constructs an empty level.
+    */
+    LevelFile();
+
+    /**
+    \brief Stops the loader and unmaps the level.
+    */
+    ~LevelFile() throw();
+
+public:
+    /**
+    \brief Maps a compiled level and starts the loader thread.
+    @param filename The level to open.
+    @retval true The level was opened.
+    @retval false The level couldn't be mapped or isn't a compiled level.
+    */
+    bool open(const std::string& filename);
+
+    /**
+    \brief Stops the loader and unmaps the level.
+    */
+    void close();
+
+    /**
+    \brief Asks the loader thread to page in a chunk.
+    @param chunk The index of the chunk.
+    @note Chunks that are already queued or paged in are ignored.
+    */
+    void request(int chunk);
+
+    /**
+    \brief Pages a chunk back out, so it can be requested again.
+    @param chunk The index of the chunk.
+    @note The chunk's pages are handed back to the system (see MappedFile::discard()),
+        so memory follows the chunks near the window instead of the size of the level.
+    */
+    void release(int chunk);
+
+    /**
+    \brief Drops every chunk that's still queued.
+    @param cancelled If this isn't NULL, it gets the chunks that were dropped.
+    */
+    void cancel(std::vector<int>* const cancelled=NULL);
+
+    /**
+    @param chunk The index of the chunk.
+    @retval true The chunk is paged in, so reading it won't stall on the disk.
+    @retval false The chunk hasn't been asked for, or the loader hasn't gotten to it yet.
+    @note Without a loader thread nothing is ever paged in ahead of time, so every chunk is as ready as it gets.
+    */
+    bool ready(int chunk) const;
+
+public:
+    /**
+    @return The tile id at (x, y), which has to be in the level.
+    */
+    int tile(int x, int y) const
+    {
+        return read16(m_chunks[chunk_index(x, y)] + (tile_index(x, y) << 1));
+    }
+
+    /**
+    @return The collision bits of row y, collision_row_bytes() of them, lowest bit first.
+    */
+    const byte* collision_row(int y) const
+    {
+        return m_collision + (y * m_collision_row_bytes);
+    }
+
+    /**
+    @return The bytes in a row of the collision plane, a multiple of 8.
+    */
+    int collision_row_bytes() const { return m_collision_row_bytes; }
+
+    /**
+    \brief Hands the collision plane's pages back to the system once it's been copied out.
+    @note The plane can still be read, it's just paged back in.
+    */
+    void discard_collision() const;
+
+    /**
+    @return The chunk holding the tile at (x, y).
+    */
+    int chunk_index(int x, int y) const
+    {
+        return ((y >> m_chunk_shift) * m_chunks_wide) + (x >> m_chunk_shift);
+    }
+
+    int tile_id_count() const { return m_tile_id_count; }
+    int tile_id(int index) const { return read16(m_tile_ids + (index << 1)); }
+
+    int spawn_count() const { return m_spawn_count; }
+    void spawn(int index, char* const type, int* const x, int* const y) const;
+
+public:
+    bool is_open() const { return m_file.is_open(); }
+
+    int width() const { return m_width; }
+    int height() const { return m_height; }
+
+    int chunk_size() const { return m_chunk_size; }
+    int chunks_wide() const { return m_chunks_wide; }
+    int chunks_high() const { return m_chunks_high; }
+
+private:
+    enum ChunkState
+    {
+        Cold,
+        Queued,
+        Warm
+    };
+
+private:
+    static int work(void* data);
+
+    static int read16(const byte* const data)
+    {
+        return data[0] | (data[1] << 8);
+    }
+
+    static unsigned int read32(const byte* const data)
+    {
+        return data[0] | (data[1] << 8) | (data[2] << 16) | (static_cast<unsigned int>(data[3]) << 24);
+    }
+
+private:
+    int tile_index(int x, int y) const
+    {
+        return ((y & m_chunk_mask) << m_chunk_shift) + (x & m_chunk_mask);
+    }
+
+    bool invalid(const std::string& filename, const char* const what);
+
+private:
+    MappedFile m_file;
+
+    std::vector<const byte*> m_chunks;
+    int m_chunk_bytes;
+
+    const byte* m_collision;
+    int m_collision_row_bytes;
+
+    const byte* m_tile_ids;
+    int m_tile_id_count;
+
+    const byte* m_spawns;
+    int m_spawn_count;
+
+    int m_width, m_height;
+    int m_chunk_size, m_chunk_shift, m_chunk_mask;
+    int m_chunks_wide, m_chunks_high;
+
+    SDL_Thread* m_thread;
+    SDL_mutex* m_lock;          /* guards the queue and the chunk states */
+    SDL_cond* m_work_ready;
+    bool m_stopping;
+
+    std::deque<int> m_requests;
+    std::vector<unsigned char> m_states;
+
+private:
+    LevelFile(const LevelFile& level) {}
+    const LevelFile& operator=(const LevelFile& rhs) { return *this; }
+};
+
+
+#endif
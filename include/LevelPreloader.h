@@ -0,0 +1,123 @@
+/**
+\file LevelPreloader.h
+\author Shane Lillie
+\brief Background level loader header.
+
+\verbatim
+Copyright 2002-2003 Energon Software
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2, or (at your option)
+any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software Foundation,
+Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+\endverbatim
+*/
+
+
+#if !defined LEVELPRELOADER_H
+#define LEVELPRELOADER_H
+
+
+#include "shared.h"
+#include "state.h"
+
+
+class World;
+
+
+/**
+\class LevelPreloader
+\brief Gets the next level ready on its own thread while the current one is played.
+
+The preloader runs World::prepare() with the images decoded, so
+mapping the level, building its collision map and navigation graph,
+and reading and scaling its images all happen off of the main thread.
+The game loop only ever polls ready(), and once it's set take() hands
+over a world that World::finish() can put in play without blocking on
+the disk or the scaler.
+
+One level is preloaded at a time, starting another throws out the
+last one.
+*/
+class LevelPreloader
+{
+public:
+    /**
+    \brief Constructs an idle preloader.
+    */
+    LevelPreloader();
+
+    /**
+    \brief Waits for and throws out anything being preloaded.
+    */
+    ~LevelPreloader() throw();
+
+public:
+    /**
+    \brief Starts preloading a level.
+    @param name The level, as passed to World::load().
+    @param video_state The scale to load the level at.
+    @retval true The level is being (or already was) preloaded.
+    @retval false The thread couldn't be started.
+    @note The call stack tracking in debug builds isn't thread safe, so debug builds prepare the level right here.
+    @note The window has to be created first.
+    */
+    bool start(const std::string& name, const VideoState& video_state);
+
+    /**
+    @retval true The level is done preloading (or failed to), so take() won't block.
+    @retval false The level is still preloading, or nothing is.
+    */
+    bool ready() const;
+
+    /**
+    \brief Hands over the preloaded level, waiting for it if it isn't ready.
+    @param name The level that's wanted.
+    @return The prepared world, which the caller owns and has to finish().
+    @retval NULL The level wasn't being preloaded or couldn't be loaded.
+    @note The preloader is idle afterwards either way.
+    */
+    World* take(const std::string& name);
+
+    /**
+    \brief Waits for and throws out anything being preloaded.
+    */
+    void cancel();
+
+    /**
+    @return The level being preloaded, or empty if the preloader is idle.
+    */
+    const std::string& name() const { return m_name; }
+
+private:
+    static int work(void* data);
+
+    // waits for the thread to finish
+    void wait();
+
+private:
+    std::string m_name;
+    VideoState m_video_state;
+
+    World* m_world;
+    bool m_ok, m_done;  /* guarded by m_lock while the thread runs */
+
+    SDL_Thread* m_thread;
+    SDL_mutex* m_lock;
+
+private:
+    LevelPreloader(const LevelPreloader& preloader) {}
+    const LevelPreloader& operator=(const LevelPreloader& rhs) { return *this; }
+};
+
+
+#endif
@@ -0,0 +1,98 @@
+/**
+\file MappedFile.h
+\author Shane Lillie
+\brief Read only memory mapped file header.
+
+\verbatim
+Copyright 2002-2003 Energon Software
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2, or (at your option)
+any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software Foundation,
+Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+\endverbatim
+*/
+
+
+
+#if !defined MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+
+#include "shared.h"
+
+
+/**
+\class MappedFile
+\brief A whole file mapped read only into memory.
+
+The file is paged in by the system as it's touched, so opening even a
+large file costs next to nothing and nothing is copied out of it.
+*/
+class MappedFile
+{
+public:
+    /**
+    \brief Constructs an unmapped file.
+    */
+    MappedFile();
+
+    /**
+    \brief Unmaps the file.
+    */
+    ~MappedFile() throw();
+
+public:
+    /**
+    \brief Maps a file.
+    @param filename The file to map.
+    @retval true The file was mapped.
+    @retval false The file couldn't be opened or mapped, or is empty.
+    */
+    bool open(const std::string& filename);
+
+    /**
+    \brief Unmaps the file.
+    */
+    void close();
+
+    /**
+    \brief Lets the system drop the pages of part of the file from memory.
+    @param start The start of the part, in the mapping.
+    @param length The length of the part.
+    @note Only the pages entirely inside the part are dropped, so the neighbouring data stays put.
+    @note The mapping stays good, the pages are just read from the file again when they're touched.
+    */
+    void discard(const byte* const start, size_t length) const;
+
+public:
+    bool is_open() const { return NULL != m_data; }
+
+    const byte* data() const { return m_data; }
+    size_t size() const { return m_size; }
+
+private:
+    const byte* m_data;
+    size_t m_size;
+
+#if defined WIN32
+    void* m_file;
+    void* m_mapping;
+#endif
+
+private:
+    MappedFile(const MappedFile& file) {}
+    const MappedFile& operator=(const MappedFile& rhs) { return *this; }
+};
+
+
+#endif
@@ -0,0 +1,210 @@
+/**
+\file NavGraph.h
+\author Shane Lillie
+\brief Platformer navigation graph header.
+
+\verbatim
+Copyright 2002-2003 Energon Software
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2, or (at your option)
+any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software Foundation,
+Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+\endverbatim
+*/
+
+
+#if !defined NAVGRAPH_H
+#define NAVGRAPH_H
+
+
+#include "shared.h"
+
+
+class CollisionGrid;
+
+
+/**
+\class NavGraph
+\brief Where a walking entity can get to in a level, and how.
+
+The nodes are segments: runs of blocks on one row that a mover can
+stand on (a collidable block under them and room for the mover above).
+A mover walks anywhere along a segment, so only getting from one
+segment to another needs an edge. A drop edge walks off the end of a
+segment and falls straight down, and a jump edge leaves from the end
+of a segment and lands on another one the mover's jump can reach.
+
+Everything is in blocks except the mover and the edge costs, which
+are in pixels. Building the graph looks at the whole collision map,
+so it's done once per level and scale and cached in a file in the
+user's cache directory.
+*/
+class NavGraph
+{
+public:
+    enum
+    {
+        Magic = 0x564e4b53,     /* "SKNV" */
+        Version = 1
+    };
+
+    enum EdgeType
+    {
+        DropEdge,
+        JumpEdge
+    };
+
+    /**
+    \struct Mover
+    \brief The size and movement of what the graph is built for, in pixels.
+    */
+    struct Mover
+    {
+        int width, height;
+        float max_speed;        /* pixels per second */
+        float jump_velocity;    /* pixels per second, up */
+
+        Mover() : width(0), height(0), max_speed(0.0f), jump_velocity(0.0f) {}
+    };
+
+    struct Segment
+    {
+        int y;                  /* the row the mover stands in */
+        int x0, x1;             /* the first and last block the mover's left side can be on */
+        int first_edge, edge_count;
+    };
+
+    struct Edge
+    {
+        int to;                 /* segment */
+        EdgeType type;
+        int from_x, to_x;       /* where the mover leaves and lands */
+        float cost;             /* pixels */
+    };
+
+    /**
+    \struct Search
+    \brief Scratch space for find_path(), kept by the caller so searching doesn't allocate.
+
+    Nodes are marked with a generation instead of being cleared, so
+    starting a search doesn't touch every node.
+    */
+    struct Search
+    {
+        std::vector<float> cost;
+        std::vector<int> entry_x;
+        std::vector<int> via;               /* the edge a node was reached by, -1 for the start */
+        std::vector<int> parent;            /* the node that edge leaves from */
+        std::vector<unsigned int> mark;     /* the generation a node was reached in */
+        std::vector<unsigned int> closed;   /* the generation a node was finished in */
+        std::vector<std::pair<float, int> > open;
+        unsigned int generation;
+
+        Search() : generation(0) {}
+    };
+
+public:
+    /**
+    \brief Constructs an empty graph.
+    */
+    NavGraph();
+
+public:
+    /**
+    \brief Builds the graph from a collision map.
+    @param collision The collision map.
+    @param block_width The width of a block in pixels.
+    @param block_height The height of a block in pixels.
+    @param mover What's walking around.
+    @param gravity The downward acceleration in pixels per second per second.
+    */
+    void build(const CollisionGrid& collision, int block_width, int block_height, const Mover& mover, float gravity);
+
+    /**
+    \brief Loads a graph that was saved for the same collision map, block size and mover.
+    @param filename The cached graph.
+    @param collision The collision map.
+    @param block_width The width of a block in pixels.
+    @param block_height The height of a block in pixels.
+    @param mover What's walking around.
+    @param gravity The downward acceleration in pixels per second per second.
+    @retval true The graph was loaded.
+    @retval false The file is missing or was saved for something else, the graph is left empty.
+    */
+    bool load(const std::string& filename, const CollisionGrid& collision, int block_width, int block_height, const Mover& mover, float gravity);
+
+    /**
+    \brief Saves the graph.
+    @param filename Where to save the graph.
+    @retval true The graph was saved.
+    @retval false The file couldn't be written.
+    @note The graph is written next to filename and renamed over it, so a reader never sees half a file.
+    */
+    bool save(const std::string& filename) const;
+
+    /**
+    \brief Throws the graph out.
+    */
+    void clear();
+
+    /**
+    \brief Finds the segment a mover is standing on.
+    @param x The column of the mover's left side.
+    @param y The row the mover stands in.
+    @return The segment.
+    @retval -1 There isn't a segment there.
+    */
+    int segment_at(int x, int y) const;
+
+    /**
+    \brief Finds the cheapest way from one place to another with A*.
+    @param from The segment to start on.
+    @param from_x The column to start in.
+    @param to The segment to get to.
+    @param to_x The column to get to.
+    @param search Scratch space, which can be reused for every search.
+    @param path Gets the edges to take, in order.
+    @retval true A way was found (path is empty if from and to are the same segment).
+    @retval false There isn't a way.
+    */
+    bool find_path(int from, int from_x, int to, int to_x, Search* const search, std::vector<int>* const path) const;
+
+public:
+    bool empty() const { return m_segments.empty(); }
+
+    int segment_count() const { return static_cast<int>(m_segments.size()); }
+    const Segment& segment(int index) const { return m_segments[index]; }
+
+    int edge_count() const { return static_cast<int>(m_edges.size()); }
+    const Edge& edge(int index) const { return m_edges[index]; }
+
+private:
+    void add_segments(const CollisionGrid& collision, int mover_width, int mover_height);
+    void add_drop(int segment, int x, const CollisionGrid& collision, int mover_width, int mover_height);
+    void add_jumps(int segment, const CollisionGrid& collision, int mover_width, int mover_height, const Mover& mover, float gravity);
+
+    // the header words that have to match for a saved graph to be used
+    void stamp(std::vector<unsigned int>* const words, const CollisionGrid& collision, int block_width, int block_height, const Mover& mover, float gravity) const;
+
+private:
+    int m_width, m_height;
+    int m_block_width, m_block_height;
+    std::vector<unsigned int> m_stamp;  /* what the graph was built for, saved as the file header */
+
+    std::vector<Segment> m_segments;    /* by row, then column */
+    std::vector<int> m_rows;            /* the first segment on each row, and one past the last row */
+    std::vector<Edge> m_edges;          /* by segment */
+};
+
+
+#endif
@@ -0,0 +1,152 @@
+/**
+\file Physics.h
+\author Shane Lillie
+\brief Entity physics state header.
+
+\verbatim
+Copyright 2002-2003 Energon Software
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2, or (at your option)
+any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software Foundation,
+Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+\endverbatim
+*/
+
+
+#if !defined PHYSICS_H
+#define PHYSICS_H
+
+
+#include "shared.h"
+
+
+class Entity;
+
+
+/**
+\class Physics
+\brief Structure-of-arrays store for the entity physics state.
+
+Every entity owns one slot in the store. The slot holds the entity's
+position, velocity, acceleration and mass, plus the position it's
+trying to move to this frame. Keeping these in contiguous arrays lets
+the kinematics step run over every entity without touching the entity
+objects themselves.
+
+\note Slots are swap-removed, so an entity's slot can change when
+    another entity is released.
+*/
+class Physics
+{
+public:
+    /**
+    \enum Flags
+    \brief Per-slot state bits.
+    */
+    enum Flags
+    {
+        Listed  = 1,    /* the owner is in the entity list */
+        HasBody = 2,    /* the owner has a sprite to collide with */
+        Removed = 4,    /* the owner will be removed on cleanup */
+        Frozen = 8,     /* the owner is too far from the camera to simulate */
+        Deferred = 16   /* the owner is warm and isn't stepped this frame */
+    };
+
+public:
+    /**
+    \brief Allocates a slot for an entity.
+    @param entity The entity that owns the slot.
+    @return The new slot.
+    @note The slot is zeroed.
+    */
+    static int allocate(Entity* const entity);
+
+    /**
+    \brief Frees an entity's slot.
+    @param slot The slot to free.
+    @note The last slot is moved into the freed one and its owner is told.
+    */
+    static void release(int slot);
+
+    /**
+    \brief Makes sure the store can hold count slots without growing.
+    @param count The number of slots.
+    */
+    static void reserve(int count);
+
+    /**
+    \brief Applies gravity and computes the target position of every simulated slot.
+    @param dt The change in time in seconds.
+    @note A slot is simulated if it's Listed, HasBody and isn't Removed or Frozen.
+    @note Every listed slot that isn't frozen gathers dt into elapsed, and
+        slots that aren't Deferred are stepped by all of it.
+    */
+    static void integrate(float dt);
+
+    /**
+    \brief Applies gravity and computes the target position of the simulated slots in a range.
+    @param dt The change in time in seconds.
+    @param begin The first slot in the range.
+    @param end One past the last slot in the range.
+    @note This only touches the slots in the range, so ranges can be run on different threads.
+    */
+    static void integrate(float dt, int begin, int end);
+
+    /**
+    \brief Applies gravity and computes the target position of one slot.
+    @param slot The slot to integrate.
+    @param dt The change in time in seconds.
+    */
+    static void integrate(int slot, float dt);
+
+    /**
+    @return The number of allocated slots.
+    */
+    static int size()
+    {
+        return static_cast<int>(owner.size());
+    }
+
+    /**
+    @retval true The slot is stepped by integrate(float).
+    @retval false The slot isn't simulated.
+    */
+    static bool simulated(int slot)
+    {
+        return (flags[slot] & (Listed | HasBody | Removed | Frozen)) == (Listed | HasBody);
+    }
+
+    /**
+    @retval true The slot's owner is simulated this frame.
+    @retval false The slot's owner is frozen or deferred.
+    */
+    static bool stepping(int slot)
+    {
+        return !(flags[slot] & (Frozen | Deferred));
+    }
+
+public:
+    static std::vector<float> position_x, position_y, position_z;
+    static std::vector<float> velocity_x, velocity_y;
+    static std::vector<float> acceleration_x, acceleration_y;
+    static std::vector<float> mass;
+
+    static std::vector<float> target_x, target_y;
+    static std::vector<float> elapsed;
+
+    static std::vector<unsigned char> flags;
+    static std::vector<Entity*> owner;
+};
+
+
+#endif
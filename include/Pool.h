@@ -0,0 +1,228 @@
+/**
+\file Pool.h
+\author Shane Lillie
+\brief Fixed-size object pool header.
+
+\verbatim
+Copyright 2002-2003 Energon Software
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2, or (at your option)
+any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software Foundation,
+Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+\endverbatim
+*/
+
+
+#if !defined POOL_H
+#define POOL_H
+
+
+#include "shared.h"
+
+
+/**
+\class PoolBase
+\brief Bookkeeping shared by every pool.
+
+Every pool registers itself here so the usage of all of them
+can be printed at once.
+*/
+class PoolBase
+{
+public:
+    /**
+    \brief Prints the usage of every pool.
+    @param out The output stream to print to.
+    */
+    static void print_pools(std::ostream& out);
+
+    /**
+    \brief Resets the high-water mark of every pool to its current usage.
+    @note Call this when a level is loaded so the marks are per-level.
+    */
+    static void reset_high_water_marks();
+
+private:
+    static std::vector<PoolBase*>& pools();
+
+public:
+    /**
+    \brief Registers the pool.
+    @param name The name to print the pool under.
+    */
+    explicit PoolBase(const std::string& name);
+
+    /**
+    \brief Unregisters the pool.
+    */
+    virtual ~PoolBase() throw();
+
+public:
+    /**
+    @return The number of objects currently allocated from the pool.
+    */
+    size_t size() const
+    {
+        return m_size;
+    }
+
+    /**
+    @return The number of objects the pool can hold without growing.
+    */
+    size_t capacity() const
+    {
+        return m_capacity;
+    }
+
+    /**
+    @return The most objects allocated at once since the mark was reset.
+    */
+    size_t high_water_mark() const
+    {
+        return m_high_water_mark;
+    }
+
+protected:
+    std::string m_name;
+
+    size_t m_size, m_capacity, m_high_water_mark;
+
+private:
+    PoolBase(const PoolBase& pool) {}
+    const PoolBase& operator=(const PoolBase& rhs) { return *this; }
+};
+
+
+/**
+\class Pool
+\brief Free-list allocator for objects of type T.
+
+Storage is grabbed from the heap in chunks and never given back
+until the pool is destroyed, so once a pool has grown to its
+high-water mark, allocating from it never touches the heap.
+
+Use it from a class-specific operator new/delete:
+\code
+void* operator new(size_t size) { return pool.allocate(size); }
+void operator delete(void* p, size_t size) { pool.release(p, size); }
+\endcode
+*/
+template <class T>
+class Pool : public PoolBase
+{
+private:
+    union Block
+    {
+        Block* next;
+        char storage[sizeof(T)];
+
+        // these are just here to force the alignment
+        long l;
+        double d;
+        void* p;
+    };
+
+public:
+    /**
+    \brief Constructs an empty pool.
+    @param name The name to print the pool under.
+    @param chunk_size The number of objects to allocate each time the pool grows.
+    */
+    Pool(const std::string& name, size_t chunk_size)
+        : PoolBase(name), m_free(NULL), m_chunk_size(chunk_size > 0 ? chunk_size : 1)
+    {
+    }
+
+    /**
+    \brief Frees all of the pool storage.
+    @note Any objects still allocated from the pool are lost.
+    */
+    virtual ~Pool() throw()
+    {
+        for(typename std::vector<Block*>::iterator it = m_chunks.begin(); it != m_chunks.end(); ++it)
+            ::operator delete(*it);
+    }
+
+public:
+    /**
+    \brief Allocates storage for one object.
+    @param size The size of the object.
+    @return The storage.
+    @note Sizes other than sizeof(T) (sub-classes of T) go to the heap.
+    @note This isn't thread safe, so the caller has to make sure it's on the main thread.
+    */
+    void* allocate(size_t size)
+    {
+        if(size != sizeof(T)) return ::operator new(size);
+
+        if(!m_free) grow(m_chunk_size);
+
+        Block* block = m_free;
+        m_free = block->next;
+
+        if(++m_size > m_high_water_mark)
+            m_high_water_mark = m_size;
+        return block;
+    }
+
+    /**
+    \brief Returns storage to the pool.
+    @param p The storage to release.
+    @param size The size of the object.
+    */
+    void release(void* p, size_t size)
+    {
+        if(!p) return;
+        if(size != sizeof(T)) {
+            ::operator delete(p);
+            return;
+        }
+
+        Block* block = static_cast<Block*>(p);
+        block->next = m_free;
+        m_free = block;
+        --m_size;
+    }
+
+    /**
+    \brief Makes sure the pool can hold at least count objects without growing.
+    @param count The number of objects.
+    */
+    void reserve(size_t count)
+    {
+        if(count > m_capacity)
+            grow(count - m_capacity);
+    }
+
+private:
+    void grow(size_t count)
+    {
+        Block* chunk = static_cast<Block*>(::operator new(count * sizeof(Block)));
+        m_chunks.push_back(chunk);
+
+        for(size_t i=0; i<count; ++i) {
+            chunk[i].next = m_free;
+            m_free = &chunk[i];
+        }
+        m_capacity += count;
+    }
+
+private:
+    std::vector<Block*> m_chunks;
+    Block* m_free;
+
+    size_t m_chunk_size;
+};
+
+
+#endif
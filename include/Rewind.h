@@ -0,0 +1,147 @@
+/**
+\file Rewind.h
+\author Shane Lillie
+\brief Rewind buffer header.
+
+\verbatim
+Copyright 2002-2003 Energon Software
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2, or (at your option)
+any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software Foundation,
+Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+\endverbatim
+*/
+
+
+
+#if !defined REWIND_H
+#define REWIND_H
+
+
+#include "shared.h"
+
+
+/**
+\class Rewind
+\brief A ring buffer of the last few seconds of recorded frames.
+
+A frame is just a block of bytes. Every keyframe_interval'th frame is a
+keyframe and is stored as is. The frames in between are stored as the
+XOR of the frame against the keyframe before it, run length encoded,
+so anything that didn't change since the keyframe costs almost nothing.
+Any frame can be rebuilt from its keyframe plus its own delta, which
+bounds the cost of stepping back no matter how far back it goes.
+
+Each delta is a 4 byte frame size followed by runs. A run is a 2 byte
+count of unchanged bytes, a 2 byte count of changed bytes, and then the
+changed bytes XORed with the keyframe.
+
+When the buffer is full the oldest frame is dropped, along with any
+frames that depended on it as their keyframe.
+*/
+class Rewind
+{
+public:
+    /**
+    \brief Constructs an empty buffer that holds nothing.
+    */
+    Rewind();
+
+public:
+    /**
+    \brief Empties the buffer and sets how much it holds.
+    @param frames The number of frames to keep.
+    @param keyframe_interval How many frames go between keyframes.
+    */
+    void reset(int frames, int keyframe_interval);
+
+    /**
+    \brief Adds a frame as the newest one.
+    @param frame The frame to add.
+    */
+    void push(const std::vector<unsigned char>& frame);
+
+    /**
+    \brief Rebuilds one of the frames.
+    @param back How many frames back from the newest to go (0 is the newest).
+    @param frame Set to the rebuilt frame.
+    @retval true The frame was rebuilt.
+    @retval false The buffer doesn't go back that far.
+    */
+    bool frame(int back, std::vector<unsigned char>* const frame) const;
+
+    /**
+    \brief Drops the newest frames.
+    @param count The number of frames to drop.
+    @note This is how the buffer is rewound, so the next push() follows the frame that's left newest.
+    */
+    void drop(int count);
+
+    /**
+    @return The number of frames in the buffer.
+    */
+    int size() const
+    {
+        return m_count;
+    }
+
+    /**
+    @return The number of bytes used by the stored frames.
+    */
+    size_t memory() const;
+
+    /**
+    \brief Writes every frame, oldest first, to a file.
+    @param filename The file to write.
+    @retval true The file was written.
+    @retval false The file couldn't be written.
+    @note Each frame is written rebuilt, after a 4 byte size.
+    */
+    bool save(const std::string& filename) const;
+
+    /**
+    \brief Prints the size of the buffer.
+    @param out The stream to print to.
+    */
+    void print(std::ostream& out) const;
+
+private:
+    struct Frame
+    {
+        bool key;
+        std::vector<unsigned char> data;
+
+        Frame() : key(false) {}
+    };
+
+private:
+    const Frame& at(int back) const
+    {
+        return m_frames[(m_first + m_count - 1 - back) % m_frames.size()];
+    }
+
+    void drop_oldest();
+
+    static void encode(const std::vector<unsigned char>& frame, const std::vector<unsigned char>& key, std::vector<unsigned char>* const delta);
+    static void decode(const std::vector<unsigned char>& delta, const std::vector<unsigned char>& key, std::vector<unsigned char>* const frame);
+
+private:
+    std::vector<Frame> m_frames;
+    int m_first, m_count;
+
+    int m_keyframe_interval;
+    int m_since_keyframe;
+};
+
+
+#endif
@@ -43,24 +43,20 @@ public:
         RunningLeft
     };
 
-private:
-    enum
+    /* what a rewind frame keeps of skratch, his physics go with the other entities */
+    struct SavedState
     {
-        DefaultWidth  = 32,
-        DefaultHeight = 64
+        int state;
+        int can_jump;
+        int has_blaster;
+        float cool_time;
     };
 
+private:
     enum
     {
-        IdleLeftAnimation,
-        IdleRightAnimation,
-        Run1LeftAnimation,
-        Run2LeftAnimation,
-        Run1RightAnimation,
-        Run2RightAnimation,
-
-        // this should match the number of animations
-        AnimationCount = 6
+        DefaultWidth  = 32,
+        DefaultHeight = 64
     };
 
     enum
@@ -71,9 +67,9 @@ private:
         SoundCount = 1
     };
 
-    static const std::string IDLE_ANIMATION_FILENAME;
-    static const std::string RUN1_ANIMATION_FILENAME;
-    static const std::string RUN2_ANIMATION_FILENAME;
+    static const std::string ANIMATION_DIRECTORY;
+    static const std::string IDLE_CLIP;
+    static const std::string RUN_CLIP;
 
     static const std::string JUMP_SOUND_FILENAME;
 
@@ -82,6 +78,16 @@ private:
     static const float HORIZONTAL_ACCEL;
     static const float JUMP_VEL;
 
+public:
+    // registers skratch's handlers with the entity collision table
+    static void register_collision_handlers();
+
+private:
+    static void on_pickup_collision(Entity* const entity, Entity* const pickup);
+    static void on_enemy_collision(Entity* const entity, Entity* const enemy);
+    static void give_blaster(Skratch* const skratch);
+    static void load_archetype(Archetype* const archetype, const VideoState& video_state);
+
 public:
     Skratch();
     virtual ~Skratch() throw()
@@ -102,15 +108,19 @@ public:
     bool has_blaster() const { return m_blaster.get() != NULL; }
     SkratchState state() const { return m_state; }
 
+    // fills in the state a rewind frame needs
+    void save_state(SavedState* const saved) const;
+
+    // puts skratch back the way save_state() found him, his animation is left to Entity::load_state()
+    void load_state(const SavedState& saved);
+
 private:
     virtual void on_animate(float dt, const std::bitset<World::CollisionSize>& collision_types, const World& world);
-    virtual void on_collision(Entity* const entity);
     virtual void set_state(int state);
 
 private:
     bool m_can_jump;
 
-    int m_sprite_indexes[AnimationCount];
     int m_sound_indexes[SoundCount];
 
     SkratchState m_state;
@@ -120,6 +130,9 @@ private:
 private:
     Skratch(const Skratch& skratch) {}
     const Skratch& operator=(const Skratch& rhs) { return *this; }
+private:
+    // the per-class entity loops call on_animate() directly
+    friend class Entity;
 };
 
 
@@ -0,0 +1,237 @@
+/**
+\file SlotMap.h
+\author Shane Lillie
+\brief Slot map container header.
+
+\verbatim
+Copyright 2002-2003 Energon Software
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2, or (at your option)
+any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software Foundation,
+Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+\endverbatim
+*/
+
+
+#if !defined SLOTMAP_H
+#define SLOTMAP_H
+
+
+#include "shared.h"
+
+
+/**
+\struct SlotHandle
+\brief Refers to a value in a SlotMap.
+\note Handles are the same for every kind of SlotMap, so they can be held without knowing what the map holds.
+*/
+struct SlotHandle
+{
+    enum
+    {
+        NoSlot = 0xffffffff
+    };
+
+    unsigned int index;
+    unsigned int generation;
+
+    /**
+    \brief Constructs a handle that doesn't refer to anything.
+    */
+    SlotHandle() : index(NoSlot), generation(0)
+    {
+    }
+
+    bool operator==(const SlotHandle& rhs) const
+    {
+        return index == rhs.index && generation == rhs.generation;
+    }
+
+    bool operator!=(const SlotHandle& rhs) const
+    {
+        return !(*this == rhs);
+    }
+};
+
+
+/**
+\class SlotMap
+\brief Contiguous storage addressed through generational handles.
+
+The values are kept packed in one vector so they can be walked like
+one. Every value also gets a handle that stays good until the value is
+erased, no matter how the values move around. Erasing swaps the last
+value into the hole, and bumps the generation of the handle's slot so
+old copies of the handle stop finding anything.
+*/
+template <class T>
+class SlotMap
+{
+public:
+    typedef SlotHandle Handle;
+
+    enum
+    {
+        NoSlot = SlotHandle::NoSlot
+    };
+
+private:
+    struct Slot
+    {
+        unsigned int value;         /* the index of the value, or the next free slot */
+        unsigned int generation;
+    };
+
+public:
+    /**
+    \brief Constructs an empty slot map.
+    */
+    SlotMap() : m_free(NoSlot)
+    {
+    }
+
+public:
+    /**
+    \brief Adds a value.
+    @param value The value to add.
+    @return The handle of the new value.
+    @note The value goes on the end of values().
+    */
+    Handle insert(const T& value)
+    {
+        unsigned int index = m_free;
+        if(NoSlot == index) {
+            index = static_cast<unsigned int>(m_slots.size());
+            Slot slot;
+            slot.generation = 0;
+            m_slots.push_back(slot);
+        } else m_free = m_slots[index].value;
+
+        m_slots[index].value = static_cast<unsigned int>(m_values.size());
+        m_values.push_back(value);
+        m_value_slots.push_back(index);
+
+        Handle handle;
+        handle.index = index;
+        handle.generation = m_slots[index].generation;
+        return handle;
+    }
+
+    /**
+    \brief Erases a value.
+    @param handle The handle of the value to erase.
+    @retval true The value was erased.
+    @retval false The handle was stale.
+    @note The last value in values() is moved into the erased value's place.
+    */
+    bool erase(const Handle& handle)
+    {
+        if(!contains(handle)) return false;
+
+        Slot& slot = m_slots[handle.index];
+        const unsigned int last = static_cast<unsigned int>(m_values.size()) - 1;
+        if(slot.value != last) {
+            m_values[slot.value] = m_values[last];
+            m_value_slots[slot.value] = m_value_slots[last];
+            m_slots[m_value_slots[slot.value]].value = slot.value;
+        }
+        m_values.pop_back();
+        m_value_slots.pop_back();
+
+        ++slot.generation;
+        slot.value = m_free;
+        m_free = handle.index;
+        return true;
+    }
+
+    /**
+    @retval true The handle refers to a value in the map.
+    @retval false The handle is stale or was never good.
+    */
+    bool contains(const Handle& handle) const
+    {
+        return handle.index < m_slots.size() && m_slots[handle.index].generation == handle.generation;
+    }
+
+    /**
+    @return The value the handle refers to.
+    @retval NULL The handle is stale.
+    */
+    T* get(const Handle& handle)
+    {
+        return contains(handle) ? &m_values[m_slots[handle.index].value] : NULL;
+    }
+
+    /**
+    \brief Makes sure the map can hold count values without growing.
+    @param count The number of values.
+    */
+    void reserve(size_t count)
+    {
+        m_values.reserve(count);
+        m_value_slots.reserve(count);
+        m_slots.reserve(count);
+    }
+
+    /**
+    \brief Erases every value and makes every handle stale.
+    */
+    void clear()
+    {
+        m_values.clear();
+        m_value_slots.clear();
+
+        m_free = NoSlot;
+        for(unsigned int i=0; i<m_slots.size(); ++i) {
+            ++m_slots[i].generation;
+            m_slots[i].value = m_free;
+            m_free = i;
+        }
+    }
+
+    /**
+    @return The number of values in the map.
+    */
+    size_t size() const
+    {
+        return m_values.size();
+    }
+
+    /**
+    @return The values, packed together in no particular order.
+    */
+    const std::vector<T>& values() const
+    {
+        return m_values;
+    }
+
+    T& operator[](size_t index)
+    {
+        return m_values[index];
+    }
+
+    const T& operator[](size_t index) const
+    {
+        return m_values[index];
+    }
+
+private:
+    std::vector<T> m_values;
+    std::vector<unsigned int> m_value_slots;
+
+    std::vector<Slot> m_slots;
+    unsigned int m_free;
+};
+
+
+#endif
@@ -0,0 +1,136 @@
+/**
+\file SpatialHash.h
+\author Shane Lillie
+\brief Spatial hash broadphase header.
+
+\verbatim
+Copyright 2002-2003 Energon Software
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2, or (at your option)
+any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software Foundation,
+Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+\endverbatim
+*/
+
+
+#if !defined SPATIALHASH_H
+#define SPATIALHASH_H
+
+
+#include "shared.h"
+
+
+class Entity;
+
+
+/**
+\class SpatialHash
+\brief Uniform grid broadphase for entity-entity collisions.
+
+Entities are inserted with a pixel bounding box and hashed into
+every cell that box touches. Queries return each entity whose box
+overlaps the query box exactly once.
+
+Entries also carry the collision layer bits they're on and the mask
+of layers they collide with. A query only returns entries where both
+sides' masks accept the other's layers.
+*/
+class SpatialHash
+{
+private:
+    struct Entry
+    {
+        Entity* entity;
+        int left, top, right, bottom;
+        unsigned int layers, mask;
+        unsigned int stamp;
+
+        Entry(Entity* const e, int l, int t, int r, int b, unsigned int ls, unsigned int m)
+            : entity(e), left(l), top(t), right(r), bottom(b), layers(ls), mask(m), stamp(0)
+        {
+        }
+    };
+
+    enum
+    {
+        // this must be a power of two
+        MinBucketCount = 256
+    };
+
+public:
+    /**
+    \brief Constructs an empty spatial hash.
+    */
+    SpatialHash();
+
+public:
+    /**
+    \brief Removes all of the entries and sets the cell size.
+    @param cell_width The width of a cell in pixels.
+    @param cell_height The height of a cell in pixels.
+    @param expected The number of entries expected to be inserted.
+    @note This keeps the allocated buckets around for reuse.
+    */
+    void clear(int cell_width, int cell_height, size_t expected);
+
+    /**
+    \brief Inserts an entity.
+    @param entity The entity to insert.
+    @param left The left edge of the entity's bounds.
+    @param top The top edge of the entity's bounds.
+    @param right The right edge of the entity's bounds (inclusive).
+    @param bottom The bottom edge of the entity's bounds (inclusive).
+    @param layers The collision layer bits the entity is on.
+    @param mask The collision layer bits the entity collides with.
+    */
+    void insert(Entity* const entity, int left, int top, int right, int bottom, unsigned int layers, unsigned int mask);
+
+    /**
+    \brief Finds the entities whose bounds overlap a box.
+    @param left The left edge of the box.
+    @param top The top edge of the box.
+    @param right The right edge of the box (inclusive).
+    @param bottom The bottom edge of the box (inclusive).
+    @param layers The collision layer bits of the querier.
+    @param mask The collision layer bits the querier collides with.
+    @param candidates This is cleared and filled with the overlapping entities.
+    @note The candidates are returned in the order they were inserted.
+    */
+    void query(int left, int top, int right, int bottom, unsigned int layers, unsigned int mask, std::vector<Entity*>* const candidates);
+
+    /**
+    @return The number of entities in the hash.
+    */
+    size_t size() const
+    {
+        return m_entries.size();
+    }
+
+private:
+    size_t bucket(int column, int row) const;
+    int column(int x) const;
+    int row(int y) const;
+
+private:
+    int m_cell_width, m_cell_height;
+
+    std::vector<Entry> m_entries;
+    std::vector<std::vector<int> > m_buckets;
+    std::vector<size_t> m_used_buckets;
+    std::vector<int> m_hits;
+
+    unsigned int m_stamp;
+};
+
+
+#endif
@@ -0,0 +1,135 @@
+/**
+\file TileCache.h
+\author Shane Lillie
+\brief Pre-rendered tile chunk cache header.
+
+\verbatim
+Copyright 2002-2003 Energon Software
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2, or (at your option)
+any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software Foundation,
+Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+\endverbatim
+*/
+
+
+
+#if !defined TILECACHE_H
+#define TILECACHE_H
+
+
+#include "shared.h"
+
+
+/**
+\class TileCache
+\brief Surfaces with whole chunks of the tile layer already drawn on them.
+
+The world is cut into chunks of chunk_width() x chunk_height() pixels.
+A chunk's surface is drawn once, and after that the chunk is one blit
+for as long as it stays in the cache. When the cache is full, the
+least recently used surface is handed out for the next chunk.
+
+Chunk surfaces start out filled with a color key, so anything that
+isn't drawn on them shows through.
+*/
+class TileCache
+{
+public:
+    /**
+    \brief Constructs an empty cache.
+    */
+    TileCache();
+
+    /**
+    \brief Frees the chunk surfaces.
+    */
+    ~TileCache() throw();
+
+public:
+    /**
+    \brief Frees every chunk surface and sets up the chunks for a world.
+    @param chunk_width The width of a chunk in pixels.
+    @param chunk_height The height of a chunk in pixels.
+    @param world_width The width of the world in pixels.
+    @param world_height The height of the world in pixels.
+    @param capacity The most chunk surfaces to keep.
+    */
+    void reset(int chunk_width, int chunk_height, int world_width, int world_height, int capacity);
+
+    /**
+    \brief Frees every chunk surface.
+    */
+    void clear();
+
+    /**
+    \brief Finds the surface of a chunk that's already drawn.
+    @param chunk The chunk to find.
+    @return The chunk's surface.
+    @retval NULL The chunk isn't in the cache.
+    */
+    SDL_Surface* find(int chunk);
+
+    /**
+    \brief Gets a cleared surface to draw a chunk on.
+    @param chunk The chunk that will be drawn.
+    @return The surface to draw the chunk on.
+    @retval NULL The surface couldn't be created.
+    @note This reuses the least recently used surface when the cache is full.
+    */
+    SDL_Surface* allocate(int chunk);
+
+    /**
+    \brief Throws out a chunk so it's drawn again the next time it's needed.
+    @param chunk The chunk to throw out.
+    */
+    void invalidate(int chunk);
+
+public:
+    /**
+    @return The chunk at (x, y) in pixels.
+    */
+    int chunk_at(int x, int y) const
+    {
+        return ((y / m_chunk_height) * m_columns) + (x / m_chunk_width);
+    }
+
+    int chunk_width() const { return m_chunk_width; }
+    int chunk_height() const { return m_chunk_height; }
+
+    int columns() const { return m_columns; }
+    int rows() const { return m_rows; }
+
+private:
+    struct Entry
+    {
+        int chunk;              /* -1 if the surface is free */
+        SDL_Surface* surface;
+        unsigned long used;
+    };
+
+private:
+    std::vector<Entry> m_entries;
+    int m_capacity;
+    unsigned long m_clock;
+
+    int m_chunk_width, m_chunk_height;
+    int m_columns, m_rows;
+
+private:
+    TileCache(const TileCache& cache) {}
+    const TileCache& operator=(const TileCache& rhs) { return *this; }
+};
+
+
+#endif
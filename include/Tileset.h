@@ -0,0 +1,115 @@
+/**
+\file Tileset.h
+\author Shane Lillie
+\brief Level tile image registry header.
+
+\verbatim
+Copyright 2002-2003 Energon Software
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2, or (at your option)
+any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software Foundation,
+Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+\endverbatim
+*/
+
+
+#if !defined TILESET_H
+#define TILESET_H
+
+
+#include "shared.h"
+
+
+/**
+\class Tileset
+\brief The block images every level draws its tiles from.
+
+A tile id is loaded from blocks/blockNN.tga and scaled to the block
+size the first time any level uses it, and after that it's just a
+lookup, even across new worlds. Map cells only hold the tile id.
+If the block size changes, the images are dropped and loaded again
+from disk so they're never scaled twice.
+*/
+class Tileset
+{
+public:
+    /**
+    \brief Makes sure a tile is loaded at a block size.
+    @param tile The tile id (0 is no tile).
+    @param width The width of a block in pixels.
+    @param height The height of a block in pixels.
+    @return The video index of the tile.
+    @retval -1 There's no tile or it couldn't be loaded.
+    */
+    static int load(int tile, int width, int height);
+
+    /**
+    \brief Reads and scales a tile without registering it.
+    @param tile The tile id (0 is no tile).
+    @param width The width of a block in pixels.
+    @param height The height of a block in pixels.
+    @return The scaled image, which the caller owns.
+    @retval NULL There's no tile or it couldn't be loaded.
+    @note This doesn't touch the tileset or the video hash, so it's safe off of the main thread.
+    */
+    static SDL_Surface* decode(int tile, int width, int height);
+
+    /**
+    \brief Registers a tile that was decoded ahead of time.
+    @param tile The tile id (0 is no tile).
+    @param width The width of a block in pixels.
+    @param height The height of a block in pixels.
+    @param image The image from decode(), which is freed either way.
+    @return The video index of the tile.
+    @retval -1 There's no tile or it couldn't be converted.
+    @note If the tile is already loaded at this size, the loaded one is kept.
+    */
+    static int adopt(int tile, int width, int height, SDL_Surface* const image);
+
+    /**
+    @param tile The tile id.
+    @return The video index of the tile.
+    @retval -1 The tile isn't loaded.
+    */
+    static int surface(int tile)
+    {
+        return (tile > 0 && tile < static_cast<int>(surfaces.size())) ? surfaces[tile] : -1;
+    }
+
+    /**
+    \brief Forgets all of the tiles.
+    */
+    static void clear();
+
+    /**
+    \brief Prints the tileset info.
+    @param out The output stream to print to.
+    */
+    static void print_tiles(std::ostream& out);
+
+private:
+    static std::string filename(int tile);
+
+    // makes room for a tile, and drops the tiles if the block size changed
+    static void reserve(int tile, int width, int height);
+
+private:
+    static std::vector<int> surfaces;  /* by tile id, -1 for none */
+    static int block_width, block_height;
+
+private:
+    Tileset() {}
+};
+
+
+#endif
@@ -0,0 +1,61 @@
+/**
+\file TypeList.h
+\author Shane Lillie
+\brief Compile-time type list header.
+
+\verbatim
+Copyright 2002-2003 Energon Software
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2, or (at your option)
+any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software Foundation,
+Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+\endverbatim
+*/
+
+
+#if !defined TYPELIST_H
+#define TYPELIST_H
+
+
+#include "shared.h"
+
+
+/**
+\struct NullType
+\brief Marks the end of a TypeList.
+*/
+struct NullType
+{
+};
+
+
+/**
+\struct TypeList
+\brief A list of types built up at compile time.
+
+Lists are nested pairs that end in NullType, so code that walks one
+handles Head and then recurses on Tail:
+
+\verbatim
+typedef TypeList<A, TypeList<B, TypeList<C, NullType> > > ABC;
+\endverbatim
+*/
+template <class H, class T>
+struct TypeList
+{
+    typedef H Head;
+    typedef T Tail;
+};
+
+
+#endif
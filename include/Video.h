@@ -27,6 +27,7 @@ Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
 
 
 class Font;
+class DirtyRects;
 
 
 /* NOTE: these must be set for proper noimage loading */
@@ -77,6 +78,13 @@ public:
     // returns the index of the image in the hash or -1 on error
     static int load_image(const std::string& filename);
 
+    // loads an image from a file into a surface that isn't added to the hash
+    // the surface is in the RGB masks above, so scale_copy() can work on it
+    // the caller has to free it and convert it to the window's format before drawing it
+    // this doesn't touch the hash or the window, so it's safe off of the main thread
+    // returns NULL on error
+    static SDL_Surface* decode_image(const std::string& filename);
+
     // adds a copy of the surface into the surface hash
     // returns the index of the new surface in the hash or -1 on error
     static int push_back(SDL_Surface* const surface, const std::string& name);
@@ -86,10 +94,20 @@ public:
     static int copy_surface(int index, const std::string& name);
     static int copy_surface(SDL_Surface* const surface, const std::string& name);
 
+    // creates a surface in the window's format that isn't added to the hash
+    // the caller has to free it
+    // returns NULL on error
+    static SDL_Surface* create_surface(int width, int height);
+
     // returns the index of the scaled copy of the surface in the hash or -1 on error
     static int scale_surface(int index, int width, int height, const std::string& name);
     static int scale_surface(SDL_Surface* const surface, int width, int height, const std::string& name);
 
+    // returns a scaled copy of the surface that isn't added to the hash or NULL on error
+    // the caller has to free it
+    // this doesn't touch the hash or the window, so it's safe off of the main thread
+    static SDL_Surface* scale_copy(SDL_Surface* const surface, int width, int height);
+
     // does scaling, but replaces the image at index
     static int scale_surface(int index, int width, int height);
 
@@ -141,6 +159,19 @@ public:
     // flips the backbuffer
     static void flip();
 
+    // presents only the given areas of the window
+    static void update_rects(std::vector<SDL_Rect>& rects);
+
+    // limits drawing on the window to rect, or the whole window if rect is NULL
+    static void set_clip_rect(SDL_Rect* const rect);
+
+    // records everything drawn on the window into dirty, or stops recording if dirty is NULL
+    static void set_dirty_rects(DirtyRects* const dirty);
+
+    // makes the next window a single buffered software surface
+    // the dirty rect renderer needs last frame to still be on the window
+    static void disable_double_buffer();
+
     // shows the cursor
     static void show_cursor();
 
@@ -156,6 +187,7 @@ public:
     static int window_height() { return window ? window->h : -1; }
     static int window_depth() { return window ? static_cast<int>(window->format->BitsPerPixel) : -1; }
     static Uint32 window_flags() { return window ? window->flags : 0; }
+    static bool double_buffered() { return window && (window->flags & SDL_DOUBLEBUF); }
 
 private:
     static void get_flags();
@@ -169,6 +201,8 @@ private:
     static SDL_Surface* window;
     static Uint32 flags;
 
+    static DirtyRects* dirty_rects;
+
 public:
     class VideoException : public std::exception
     {
@@ -0,0 +1,116 @@
+/**
+\file WorkerPool.h
+\author Shane Lillie
+\brief Worker thread pool header.
+
+\verbatim
+Copyright 2002-2003 Energon Software
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2, or (at your option)
+any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software Foundation,
+Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+\endverbatim
+*/
+
+
+#if !defined WORKERPOOL_H
+#define WORKERPOOL_H
+
+
+#include "shared.h"
+
+
+/**
+\class WorkerPool
+\brief A fixed set of threads that split a range of work between them.
+
+Each run() hands worker i the i'th contiguous chunk of the range and
+waits for every chunk to finish, so anything a job records per chunk
+can be merged afterwards in chunk order and comes out the same no
+matter how the threads were scheduled.
+
+With no threads started, nothing should use the pool and the callers
+keep their single threaded path.
+*/
+class WorkerPool
+{
+public:
+    /**
+    \brief Runs one chunk of the work.
+    @param begin The first index in the chunk.
+    @param end One past the last index in the chunk.
+    @param chunk The index of the chunk.
+    @param data The data passed to run().
+    */
+    typedef void (*Job)(int begin, int end, int chunk, const void* data);
+
+public:
+    /**
+    \brief Starts the worker threads.
+    @param count The number of threads to start.
+    @retval true The threads were started.
+    @retval false The threads couldn't be started, so the pool is left empty.
+    @note The call stack tracking in debug builds isn't thread safe, so debug builds never start any threads.
+    */
+    static bool start(int count);
+
+    /**
+    \brief Stops and waits for all of the worker threads.
+    */
+    static void stop();
+
+    /**
+    \brief Splits [0, count) into one chunk per thread and runs the job on every chunk.
+    @param job The job to run.
+    @param count The size of the range.
+    @param data The data to pass to the job.
+    @note This doesn't return until every chunk has finished.
+    */
+    static void run(Job job, int count, const void* data);
+
+    /**
+    @return The number of worker threads (and chunks per run).
+    */
+    static int threads()
+    {
+        return static_cast<int>(workers.size());
+    }
+
+    /**
+    @return The chunk the calling thread is working on.
+    @retval -1 The calling thread isn't a worker.
+    */
+    static int current_chunk();
+
+private:
+    static int work(void* data);
+
+private:
+    static std::vector<SDL_Thread*> workers;
+    static std::vector<Uint32> worker_ids;
+
+    static SDL_mutex* lock;
+    static SDL_cond* work_ready;
+    static SDL_cond* work_done;
+
+    static Job job;
+    static const void* job_data;
+    static int job_count;
+
+    static unsigned long generation;
+    static int pending;
+    static bool stopping;
+};
+
+
+#endif
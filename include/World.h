@@ -23,6 +23,10 @@ Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
 
 
 #include "shared.h"
+#include "LevelFile.h"
+#include "CollisionGrid.h"
+#include "TileCache.h"
+#include "NavGraph.h"
 
 
 class Skratch;
@@ -37,23 +41,6 @@ struct VideoState;
 
 class World
 {
-private:
-    struct MapBlock
-    {
-        enum Type
-        {
-            Collidable,
-            NotCollidable
-        };
-
-        Type type;
-        int surface_index;
-
-        MapBlock(Type t, int i) : type(t), surface_index(i)
-        {
-        }
-    };
-
 public:
     static const float GRAVITY;
     static const float FRICTION;
@@ -71,6 +58,89 @@ public:
         CollisionSize = 6
     };
 
+    /**
+    \struct Contact
+    \brief Where a box swept through the collision map first touches a block.
+    */
+    struct Contact
+    {
+        float time;             /* the fraction of the motion before contact (1 if none) */
+        int normal_x, normal_y; /* the side of the block that was hit */
+
+        Contact() : time(1.0f), normal_x(0), normal_y(0) {}
+    };
+
+    /**
+    \struct RayHit
+    \brief Where a ray cast through the collision map first hits a block.
+    */
+    struct RayHit
+    {
+        float distance;         /* along the ray, in pixels (the max distance if nothing was hit) */
+        int x, y;               /* the block that was hit (-1 if none) */
+        int normal_x, normal_y; /* the side of the block that was hit (0 if the ray started inside it) */
+
+        RayHit() : distance(0.0f), x(-1), y(-1), normal_x(0), normal_y(0) {}
+
+        bool hit() const { return x >= 0; }
+    };
+
+    /**
+    \struct Spawn
+    \brief Where the level's spawn table puts an entity when the level starts.
+    */
+    struct Spawn
+    {
+        enum Type
+        {
+            BlasterSpawn,
+            BlueCollarSuitSpawn
+        };
+
+        Type type;
+        int x, y;   /* in blocks */
+
+        Spawn(Type t, int bx, int by) : type(t), x(bx), y(by) {}
+    };
+
+    /**
+    \struct ParallaxLayer
+    \brief A repeating image scrolled behind the tiles.
+
+    A factor of 1 scrolls the layer with the world, 0 keeps it still.
+    Layers line up with the bottom of the world, where levels start.
+    */
+    struct ParallaxLayer
+    {
+        int index;          /* video index of the image, at its own size */
+        float x_factor, y_factor;
+
+        ParallaxLayer(int i, float x, float y) : index(i), x_factor(x), y_factor(y) {}
+    };
+
+    /**
+    \struct Snapshot
+    \brief A level as it was right after it was loaded.
+
+    The tiles themselves stay in the world's mapped level, and their
+    surfaces stay scaled, so putting a snapshot back doesn't touch the
+    disk or the video code.
+    */
+    struct Snapshot
+    {
+        std::string name;
+
+        int width, height;
+        int block_width, block_height;
+        int blocks_wide, blocks_high;
+        Vector<int> position;
+        std::vector<ParallaxLayer> layers;
+
+        std::vector<Spawn> spawns;
+
+        Snapshot() : width(0), height(0), block_width(0), block_height(0), blocks_wide(0), blocks_high(0) {}
+    };
+
 private:
     enum
     {
@@ -78,29 +148,111 @@ private:
         DefaultBlockHeight = 32
     };
 
+    enum
+    {
+        // how many chunks past the window to keep paged in
+        ChunkMargin = 1,
+
+        // how many frames ahead of the scrolling to page in chunks
+        PrefetchFrames = 30
+    };
+
+    enum
+    {
+        // how many blocks a box that starts out inside the map can be pushed out of
+        MaxDepenetrationSteps = 4
+    };
+
+    enum
+    {
+        // the smallest pre-rendered chunk of tiles, in pixels
+        // chunks are never smaller than the window either
+        RenderChunkSize = 512,
+
+        // how many pre-rendered chunks to keep, the (up to) four the window is on and the ones ahead of the scrolling
+        TileCacheSize = 9,
+
+        // how many pre-rendered chunks stream_chunks() draws ahead of the scrolling each frame
+        ChunkBakesPerFrame = 1
+    };
+
 public:
     World();
+    ~World() throw();
 
 public:
     // loads a world
     // worlds are in '$(DATADIR)/levels/name/'
     // positions skratch where he should be in the map
+    // the level has to be compiled (level.bin), it's mapped and used in place
+    // the background layers are listed in background.layers, or background.tga is a single half speed layer
+    // this is just prepare() and finish()
     bool load(const std::string& name, const VideoState& video_state, Skratch* const skratch);
 
+    // does the part of loading that doesn't need the main thread:
+    // maps the level, builds the collision map and navigation graph, and reads the spawn and layer lists
+    // if decode is set the tile and layer images are read and scaled too, otherwise finish() loads them
+    // nothing here touches the video hash, the tileset or the entity list, so it's safe off of the main thread
+    // the window has to be created first
+    bool prepare(const std::string& name, const VideoState& video_state, bool decode);
+
+    // does the rest of loading on the main thread, after prepare() succeeded
+    // registers (or loads) the tile and layer images, caches a newly built navigation graph,
+    // spawns the entities and positions skratch
+    // the entity list should be empty
+    bool finish(const VideoState& video_state, Skratch* const skratch);
+
+    // saves the level as it was loaded
+    // this should be called right after load(), before anything has moved
+    void snapshot(Snapshot* const snapshot) const;
+
+    // puts a snapshot back and respawns its entities without going to disk
+    // the entity list should be empty
+    // returns false if the snapshot is of another level or was made at a different scale
+    bool restore(const Snapshot& snapshot, const VideoState& video_state, Skratch* const skratch);
+
     // renders the world to the window
     // renders all entities but Skratch
     void render();
 
+    // changes a block until the level is reloaded or restored
+    // only the pre-rendered chunk holding the block is redrawn
+    void set_block(int x, int y, int tile, bool collidable);
+
     // scrolls the world in a direction
+    // this also pages in the chunks the scrolling is headed for, and remembers where skratch is for the AI
     void scroll(const Skratch& skratch);
 
-    // tests for entity collisions in the world
+    // tests for entity collisions in the world along the path from old_position to new_position
     // sets new_position to the position the entity would stop at
     // returns the set of collisions that occured
     std::bitset<CollisionSize> collision(const Vector<float>& old_position, Vector<float>* const new_position, int entity_width, int entity_height) const;
 
+    // sweeps a box from position by (dx, dy) through the collision map
+    // returns the first contact along the way
+    Contact sweep(const Vector<float>& position, float dx, float dy, int width, int height) const;
+
+    // walks the blocks a ray from origin (in pixels) along direction passes through, up to max_distance pixels
+    // returns the first collidable block it reaches
+    RayHit raycast(const Vector<float>& origin, const Vector<float>& direction, float max_distance) const;
+
+    // finds the collidable blocks a box (in pixels) touches
+    // up to max_blocks of them are put in blocks, row by row
+    // returns how many were put in blocks
+    // if blocks is NULL, this just counts every one of them (max_blocks is ignored)
+    int overlap(const Vector<float>& position, int width, int height, Vector<int>* const blocks, int max_blocks) const;
+
+    // returns whether nothing collidable is on the line from a to b (in pixels)
+    bool line_of_sight(const Vector<float>& a, const Vector<float>& b) const;
+
+    // times the swept collision test against the old discrete one
+    void benchmark_collision(std::ostream& out, int queries) const;
+
 public:
+    const std::string& name() const { return m_name; }
+
     const Vector<int>& position() const { return m_position; }
+    void set_position(const Vector<int>& position) { m_position = position; }
 
     int width() const { return m_width; }
     int height() const { return m_height; }
@@ -111,11 +263,79 @@ public:
     int pixel_width() const { return m_width * m_block_width; }
     int pixel_height() const { return m_height * m_block_height; }
 
+    // where the suits can walk, built for the suits when the level has any
+    // set_block() doesn't change it
+    const NavGraph& navigation() const { return m_navigation; }
+
+    // the middle of the bottom of skratch as of the last scroll()
+    const Vector<float>& player_feet() const { return m_player_feet; }
+
+private:
+    std::bitset<CollisionSize> discrete_collision(const Vector<float>& old_position, Vector<float>* const new_position, int entity_width, int entity_height) const;
+    void sweep_block(int x, int y, const Vector<float>& position, float dx, float dy, int width, int height, Contact* const contact) const;
+
+    // pushes a box that overlaps collidable blocks out along the shallowest open side
+    // returns the collisions for the sides it was pushed off of
+    std::bitset<CollisionSize> depenetrate(Vector<float>* const position, int width, int height) const;
+
+    bool collidable(int x, int y) const;
+
+    // the video index of the tile at (x, y), which has to be in the world
+    int surface(int x, int y) const;
+
+    // draws the parallax layers, back to front, wrapping each across the window
+    void render_background() const;
+
+    // draws the tiles in an area of the world (in pixels) from the pre-rendered chunks
+    // the tiles go to (target_x, target_y) on target, or the window if target is NULL
+    void draw_tiles(int x, int y, int width, int height, SDL_Surface* const target, int target_x, int target_y);
+
+    // shifts last frame's tile layer by the scroll and draws the strips that came into view
+    // returns false if there isn't a tile layer buffer to use
+    bool render_tile_layer();
+
+    // draws the tiles of a pre-rendered chunk onto its surface
+    void bake_chunk(int chunk, SDL_Surface* const surface) const;
+
+    // draws the pre-rendered chunks over an area of the world (in pixels) that aren't in the cache yet
+    // if streamed is true, chunks with tiles that aren't paged in yet are left for later
+    // stops after max_bakes chunks, unless it's negative
+    // returns how many chunks were drawn
+    int bake_chunks(int x, int y, int width, int height, int max_bakes, bool streamed);
+
+    void build_collision();
+    void stream_chunks();
+
+private:
+    /**
+    \struct PendingLayer
+    \brief A background layer between prepare() and finish().
+    */
+    struct PendingLayer
+    {
+        std::string filename;
+        float x_factor, y_factor;
+        SDL_Surface* image;     /* decoded and scaled by prepare(), or NULL */
+
+        PendingLayer(const std::string& f, float x, float y) : filename(f), x_factor(x), y_factor(y), image(NULL) {}
+    };
+
 private:
-    bool load_collision_map(std::string path);
-    bool load_texture_map(std::string path);
-    bool load_entity_map(std::string path, const VideoState& video_state);
-    void load_background(std::string path);
+    bool load_level(std::string path);
+    void read_background(std::string path, const VideoState& video_state, bool decode);
+    void load_background(const VideoState& video_state);
+    void load_navigation(const std::string& name, const VideoState& video_state);
+    void save_navigation();
+    void decode_tiles();
+
+    // image is the layer decoded and scaled ahead of time, or NULL to load it here, and it's freed either way
+    int load_layer_image(const std::string& filename, const VideoState& video_state, SDL_Surface* const image) const;
+
+    // frees whatever prepare() decoded that finish() didn't take
+    void free_decoded();
+
+    void spawn_entities(const VideoState& video_state) const;
+    void place(Skratch* const skratch) const;
 
 public:
     // outputs the world to an output stream
@@ -124,13 +344,40 @@ public:
 private:
     Vector<int> m_position;
 
-    std::vector<MapBlock> m_blocks;
+    std::vector<Spawn> m_spawns;
+    std::string m_name;
 
     int m_width, m_height;
     int m_block_width, m_block_height;
     int m_blocks_wide, m_blocks_high;
 
-    int m_background_index;
+    std::vector<ParallaxLayer> m_layers;    /* back to front */
+
+    std::vector<std::pair<int, SDL_Surface*> > m_decoded_tiles;    /* tile id and image, from prepare() */
+    std::vector<PendingLayer> m_pending_layers;                     /* back to front, from prepare() */
+
+    LevelFile m_level;
+    CollisionGrid m_collision;
+    std::vector<int> m_prefetched;      /* the chunks asked to be paged in */
+    std::map<int, int> m_edits;         /* tile ids set by set_block(), by (y * width) + x */
+
+    TileCache m_tile_cache;
+
+    bool m_scroll_reuse;
+    SDL_Surface* m_tile_layer;          /* last frame's tiles, for scroll_reuse */
+    Vector<int> m_tile_layer_position;
+    bool m_tile_layer_valid;
+
+    Vector<int> m_scroll_velocity;  /* pixels per frame */
+
+    NavGraph m_navigation;
+    std::string m_navigation_cache;     /* where the graph is cached, empty if there's nowhere to */
+    bool m_navigation_unsaved;          /* built by prepare(), saved by finish() */
+    Vector<float> m_player_feet;
+
+private:
+    World(const World& world) {}
+    const World& operator=(const World& rhs) { return *this; }
 };
 
 
@@ -37,6 +37,21 @@ bool game_init(State* const state, const Video& video, const Audio& audio);
 void game_run(State* const state);
 void game_shutdown(State* const state);
 
+/*
+writes the last few seconds of play to a file, for reproducing crashes
+
+the file is every rewind frame, oldest first, each one a 4 byte little endian size and then the frame.
+a frame is in the byte order and type sizes of the machine that wrote it:
+    the RewindHeader (game.cc): world x and y, lives, score and then skratch's Skratch::SavedState
+    the cleanup count (the graveyard clock)
+    the physics slot count n, then n entity ids (Entity::id()), and n each of position x, position y,
+        velocity x, velocity y, acceleration x, acceleration y and elapsed seconds (floats),
+        and n Physics::Flags bytes
+    the animation slot count m, then m entity ids, m clip indexes, m clip seconds (floats) and m sprite indexes
+the clip and sprite indexes are into the entity's archetype, -1 for none
+*/
+void save_rewind(const std::string& filename);
+
 /* this is a special case shutdown (it misses a lot of cleanup, but gets the job done). only use in an emergency */
 void game_shutdown();
 
@@ -65,6 +65,7 @@ Also some good constants and portability tools are collected here...
 #include <utility>
 #include <iostream>
 #include <fstream>
+#include <sstream>
 
 #include <signal.h>
 
@@ -87,8 +87,10 @@ struct VideoState
 {
     int width, height, bpp;             /* these are used for creating the window, actual width/height/depth is in the Video class */
     float width_scale, height_scale;    /* these are how much to scale images from the default size */
+    bool scroll_reuse;                  /* shift last frame's tile layer instead of drawing it all again */
+    bool dirty_rects;                   /* only redraw and present what changed while the camera is parked */
 
-    VideoState() : width(0), height(0), bpp(0), width_scale(0.0f), height_scale(0.0f)
+    VideoState() : width(0), height(0), bpp(0), width_scale(0.0f), height_scale(0.0f), scroll_reuse(false), dirty_rects(false)
     {
     }
 };
@@ -125,6 +127,7 @@ struct State
     bool paused;
     bool fps;
     bool fullscreen;
+    int threads;    /* worker threads for the entity update, 0 runs it all on the main thread */
 
     struct PlayerState player_state;
     struct VideoState video_state;
@@ -137,7 +140,7 @@ struct State
     World* world;
     Timer* timer;
 
-    State() : game_state(Quit), paused(false), fps(/*false*/true), fullscreen(false), menu_state(None), menu_type(NoMenu), world(NULL), timer(NULL)
+    State() : game_state(Quit), paused(false), fps(/*false*/true), fullscreen(false), threads(0), menu_state(None), menu_type(NoMenu), world(NULL), timer(NULL)
     {
     }
 };
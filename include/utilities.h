@@ -44,6 +44,14 @@ Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
 */
 void create_path(const std::string& path, unsigned int mode);
 
+/**
+\brief Gets the directory to cache generated files in for the current user.
+@return The directory, ending in a path separator.
+@retval "" There's no per-user directory to use.
+@note The directory isn't created, use create_path() before writing to it.
+*/
+std::string get_cache_dir();
+
 
 /*
  *  cross-platform functions
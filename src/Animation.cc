@@ -0,0 +1,154 @@
+/**
+\file Animation.cc
+\author Shane Lillie
+\brief Entity animation state source.
+
+\verbatim
+Copyright 2002-2003 Energon Software
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2, or (at your option)
+any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software Foundation,
+Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+\endverbatim
+*/
+
+
+#include "shared.h"
+#include "Animation.h"
+#include "Entity.h"
+
+
+/*
+ *  Animation class variables
+ *
+ */
+
+
+std::vector<const AnimationClip*> Animation::clip;
+std::vector<float> Animation::seconds;
+std::vector<int> Animation::sprite;
+
+std::vector<unsigned char> Animation::awake;
+std::vector<Entity*> Animation::owner;
+
+
+/*
+ *  Animation class functions
+ *
+ */
+
+
+int Animation::allocate(Entity* const entity)
+{
+    ENTER_FUNCTION(Animation::allocate);
+
+    clip.push_back(NULL);
+    seconds.push_back(0.0f);
+    sprite.push_back(-1);
+
+    awake.push_back(0);
+    owner.push_back(entity);
+
+    return size() - 1;
+}
+
+
+void Animation::reserve(int count)
+{
+    ENTER_FUNCTION(Animation::reserve);
+
+    if(count <= 0) return;
+
+    clip.reserve(count);
+    seconds.reserve(count);
+    sprite.reserve(count);
+
+    awake.reserve(count);
+    owner.reserve(count);
+}
+
+
+void Animation::release(int slot)
+{
+    ENTER_FUNCTION(Animation::release);
+
+    if(slot < 0 || slot >= size()) return;
+
+    const int last = size() - 1;
+    if(slot != last) {
+        clip[slot] = clip[last];
+        seconds[slot] = seconds[last];
+        sprite[slot] = sprite[last];
+
+        awake[slot] = awake[last];
+        owner[slot] = owner[last];
+        owner[slot]->m_animation_slot = slot;
+    }
+
+    clip.pop_back();
+    seconds.pop_back();
+    sprite.pop_back();
+
+    awake.pop_back();
+    owner.pop_back();
+}
+
+
+void Animation::play(int slot, const AnimationClip* const c)
+{
+    ENTER_FUNCTION(Animation::play);
+
+    if(!c || c == clip[slot]) return;
+
+    clip[slot] = c;
+    seconds[slot] = 0.0f;
+    sprite[slot] = c->ticks.empty() ? -1 : c->ticks[0];
+}
+
+
+void Animation::show(int slot, int s)
+{
+    ENTER_FUNCTION(Animation::show);
+
+    clip[slot] = NULL;
+    seconds[slot] = 0.0f;
+    sprite[slot] = s;
+}
+
+
+void Animation::advance(float dt)
+{
+    ENTER_FUNCTION(Animation::advance);
+
+    const int count = size();
+    for(int i=0; i<count; ++i) {
+        if(awake[i] && clip[i])
+            advance(i, dt);
+    }
+}
+
+
+void Animation::advance(int slot, float dt)
+{
+    const AnimationClip* const c = clip[slot];
+    if(!c || c->ticks.empty()) return;
+
+    float s = seconds[slot] + dt;
+    if(s >= c->length_seconds)
+        s = c->loop ? std::fmod(s, c->length_seconds) : c->length_seconds;
+    seconds[slot] = s;
+
+    const int last = static_cast<int>(c->ticks.size()) - 1;
+    const int tick = static_cast<int>(s * c->inverse_tick_seconds);
+    sprite[slot] = c->ticks[tick < last ? tick : last];
+}
@@ -0,0 +1,232 @@
+/**
+\file Archetype.cc
+\author Shane Lillie
+\brief Shared entity media source.
+
+\verbatim
+Copyright 2002-2003 Energon Software
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2, or (at your option)
+any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software Foundation,
+Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+\endverbatim
+*/
+
+
+#include "shared.h"
+#include "Archetype.h"
+#include "Video.h"
+#include "state.h"
+
+
+/*
+ *  Archetype class variables
+ *
+ */
+
+
+std::map<std::string, Archetype> Archetype::archetypes;
+
+
+/*
+ *  Archetype class functions
+ *
+ */
+
+
+const Archetype& Archetype::get(const std::string& name, Loader loader, const VideoState& video_state)
+{
+    ENTER_FUNCTION(Archetype::get);
+
+    Archetype& archetype = archetypes[name];
+    if(archetype.m_name.empty() || archetype.m_width_scale != video_state.width_scale || archetype.m_height_scale != video_state.height_scale) {
+        archetype.m_name = name;
+        archetype.m_width_scale = video_state.width_scale;
+        archetype.m_height_scale = video_state.height_scale;
+        archetype.m_sprites.clear();
+        archetype.m_frames.clear();
+        archetype.m_clips.clear();
+
+        loader(&archetype, video_state);
+    }
+    return archetype;
+}
+
+
+void Archetype::clear()
+{
+    ENTER_FUNCTION(Archetype::clear);
+
+    archetypes.clear();
+}
+
+
+void Archetype::print_archetypes(std::ostream& out)
+{
+    ENTER_FUNCTION(Archetype::print_archetypes);
+
+    out << "I have " << archetypes.size() << " archetypes" << std::endl;
+    for(std::map<std::string, Archetype>::const_iterator it = archetypes.begin(); it != archetypes.end(); ++it) {
+        out << it->first << ":";
+        for(std::vector<int>::const_iterator sprite = it->second.m_sprites.begin(); sprite != it->second.m_sprites.end(); ++sprite)
+            out << " " << *sprite;
+        out << std::endl;
+    }
+}
+
+
+/*
+ *  Archetype methods
+ *
+ */
+
+
+Archetype::Archetype() : m_width_scale(0.0f), m_height_scale(0.0f)
+{
+}
+
+
+void Archetype::set_sprite(int index, int sprite_index)
+{
+    ENTER_FUNCTION(Archetype::set_sprite);
+
+    if(index < 0) return;
+    if(index >= static_cast<int>(m_sprites.size()))
+        m_sprites.resize(index + 1, -1);
+    m_sprites[index] = sprite_index;
+}
+
+
+bool Archetype::load_clips(const std::string& directory, int width, int height, const VideoState& video_state)
+{
+    ENTER_FUNCTION(Archetype::load_clips);
+
+    const std::string path(directory + "/animation.clips");
+    std::ifstream infile(path.c_str());
+    if(!infile) {
+        std::cerr << "Couldn't open animation clips - " << path << std::endl;
+        return false;
+    }
+
+    std::string line;
+    while(std::getline(infile, line)) {
+        if(line.empty() || '#' == line[0]) continue;
+
+        std::istringstream fields(line);
+        std::string name, loop, mirror;
+        if(!(fields >> name >> loop >> mirror)) {
+            std::cerr << "Invalid animation clip in " << path << ": " << line << std::endl;
+            continue;
+        }
+
+        std::vector<std::string> frames;
+        std::vector<float> durations;
+
+        std::string frame;
+        float duration;
+        while(fields >> frame >> duration) {
+            if(duration <= 0.0f) continue;
+            frames.push_back(frame);
+            durations.push_back(duration);
+        }
+        if(frames.empty()) {
+            std::cerr << "Animation clip " << name << " in " << path << " has no frames" << std::endl;
+            continue;
+        }
+
+        // the shortest frame sets the tick, longer frames just repeat
+        AnimationClip c;
+        c.name = name;
+        c.loop = ("once" != loop);
+        c.tick_seconds = *std::min_element(durations.begin(), durations.end());
+        c.inverse_tick_seconds = 1.0f / c.tick_seconds;
+
+        std::vector<int> repeats;
+        for(size_t i=0; i<frames.size(); ++i) {
+            repeats.push_back(std::max(1, static_cast<int>((durations[i] * c.inverse_tick_seconds) + 0.5f)));
+            c.ticks.insert(c.ticks.end(), repeats[i], load_frame(directory, frames[i], false, width, height, video_state));
+        }
+        c.length_seconds = c.ticks.size() * c.tick_seconds;
+        m_clips.push_back(c);
+
+        if("mirror" == mirror) {
+            c.mirrored = true;
+            c.ticks.clear();
+            for(size_t i=0; i<frames.size(); ++i)
+                c.ticks.insert(c.ticks.end(), repeats[i], load_frame(directory, frames[i], true, width, height, video_state));
+            m_clips.push_back(c);
+        }
+    }
+    infile.clear(); infile.close();
+    return true;
+}
+
+
+const AnimationClip* Archetype::clip(const std::string& name, bool mirrored) const
+{
+    ENTER_FUNCTION(Archetype::clip);
+
+    for(std::vector<AnimationClip>::const_iterator it = m_clips.begin(); it != m_clips.end(); ++it) {
+        if(it->mirrored == mirrored && it->name == name)
+            return &(*it);
+    }
+    return NULL;
+}
+
+
+int Archetype::find_sprite(int sprite_index) const
+{
+    ENTER_FUNCTION(Archetype::find_sprite);
+
+    if(sprite_index < 0) return -1;
+
+    const std::vector<int>::const_iterator it = std::find(m_sprites.begin(), m_sprites.end(), sprite_index);
+    return (it != m_sprites.end()) ? static_cast<int>(it - m_sprites.begin()) : -1;
+}
+
+
+int Archetype::find_clip(const AnimationClip* const clip) const
+{
+    ENTER_FUNCTION(Archetype::find_clip);
+
+    for(size_t i=0; i<m_clips.size(); ++i) {
+        if(&m_clips[i] == clip)
+            return static_cast<int>(i);
+    }
+    return -1;
+}
+
+
+int Archetype::load_frame(const std::string& directory, const std::string& frame, bool mirrored, int width, int height, const VideoState& video_state)
+{
+    ENTER_FUNCTION(Archetype::load_frame);
+
+    const std::string key(mirrored ? frame + "_mirrored" : frame);
+
+    std::map<std::string, int>::const_iterator it = m_frames.find(key);
+    if(it != m_frames.end())
+        return m_sprites[it->second];
+
+    int sprite_index = -1;
+    if(mirrored) {
+        sprite_index = Video::flip_surface_horizontal(load_frame(directory, frame, false, width, height, video_state), m_name + "_" + key);
+    } else {
+        sprite_index = Video::scale_surface(Video::load_image(directory + "/" + frame + ".tga"),
+            static_cast<int>(width * video_state.width_scale), static_cast<int>(height * video_state.height_scale));
+    }
+    Video::set_color_key(sprite_index, 0, 255, 0);
+
+    m_frames[key] = sprite_count();
+    set_sprite(sprite_count(), sprite_index);
+    return sprite_index;
+}
@@ -42,6 +42,61 @@ const std::string Blaster::BlasterShot::ANIMATION_FILENAME(DATADIR "/items/blast
 const float Blaster::BlasterShot::HORIZONTAL_VEL = 650.0f;
 
 
+/*
+ *  Blaster::BlasterShot class variables
+ *
+ */
+
+
+Pool<Blaster::BlasterShot> Blaster::BlasterShot::pool("Blaster::BlasterShot", PoolChunkSize);
+const Archetype* Blaster::BlasterShot::archetype = NULL;
+
+
+/*
+ *  Blaster::BlasterShot class functions
+ *
+ */
+
+
+void* Blaster::BlasterShot::operator new(size_t size)
+{
+    // the pool's free list isn't thread safe either, so this can't wait for the constructor
+    check_main_thread();
+    return pool.allocate(size);
+}
+
+
+void Blaster::BlasterShot::operator delete(void* p, size_t size)
+{
+    pool.release(p, size);
+}
+
+
+void Blaster::BlasterShot::reserve(size_t count)
+{
+    ENTER_FUNCTION(Blaster::BlasterShot::reserve);
+
+    pool.reserve(count);
+}
+
+
+void Blaster::BlasterShot::load_shared_media(const VideoState& video_state)
+{
+    ENTER_FUNCTION(Blaster::BlasterShot::load_shared_media);
+
+    archetype = &Archetype::get("blaster_shot", load_archetype, video_state);
+}
+
+
+void Blaster::BlasterShot::load_archetype(Archetype* const archetype, const VideoState& video_state)
+{
+    ENTER_FUNCTION(Blaster::BlasterShot::load_archetype);
+
+    archetype->set_sprite(0, Entity::load_sprite(ANIMATION_FILENAME, DefaultWidth, DefaultHeight, video_state));
+    Video::set_color_key(archetype->sprite(0), 0, 255, 0);
+}
+
+
 /*
  *  Blaster::BlasterShot methods
  *
@@ -52,22 +107,38 @@ Blaster::BlasterShot::BlasterShot(const Skratch& skratch, const World& world) :
 {
     ENTER_FUNCTION(Blaster::BlasterShot::BlasterShot);
 
-    m_mass = 0.0f;
-    m_position = skratch.position().snap();
-    m_position.add_y(world.block_height());
+    set_type(this);
+    set_mass(0.0f);
+    set_collision_layer(ProjectileLayer, layer_bit(EnemyLayer));
+
+    Vector<float> p(skratch.position().snap());
+    p.add_y(world.block_height());
 
     switch(skratch.state())
     {
     case Skratch::IdleRight:
     case Skratch::RunningRight:
-        m_position.add_x(world.block_width());
-        m_velocity = Vector<float>(HORIZONTAL_VEL, 0.0f, 0.0f);
+        p.add_x(world.block_width());
+        set_velocity(Vector<float>(HORIZONTAL_VEL, 0.0f, 0.0f));
         break;
     case Skratch::IdleLeft:
     case Skratch::RunningLeft:
-        m_velocity = Vector<float>(-HORIZONTAL_VEL, 0.0f, 0.0f);
+        set_velocity(Vector<float>(-HORIZONTAL_VEL, 0.0f, 0.0f));
         break;
     }
+    set_position(p);
+}
+
+
+void Blaster::BlasterShot::use_shared_media(const VideoState& video_state)
+{
+    ENTER_FUNCTION(Blaster::BlasterShot::use_shared_media);
+
+    if(!archetype) load_shared_media(video_state);
+
+    use_archetype(*archetype);
+    show(sprite(0));
+    enable_body();
 }
 
 
@@ -86,8 +157,9 @@ void Blaster::BlasterShot::load_sprites(const VideoState& video_state)
 {
     ENTER_FUNCTION(Blaster::BlasterShot::load_sprites);
 
-    m_current_sprite_index = Entity::load_sprite(ANIMATION_FILENAME, DefaultWidth, DefaultHeight, video_state);
-    Video::set_color_key(m_current_sprite_index, 0, 255, 0);
+    load_shared_media(video_state);
+    use_archetype(*archetype);
+    show(sprite(0));
 }
 
 
@@ -95,7 +167,8 @@ void Blaster::BlasterShot::on_animate(float dt, const std::bitset<World::Collisi
 {
     ENTER_FUNCTION(Blaster::BlasterShot::on_animate);
 
-    if(collision_types.count() > 0 || m_position.x() < 0.0f || m_position.y() < 0.0f)
+    const Vector<float> p(position());
+    if(collision_types.count() > 0 || p.x() < 0.0f || p.y() < 0.0f)
         set_removable();
 }
 
@@ -111,6 +184,21 @@ const std::string Blaster::SHOOT_SOUND_FILENAME(DATADIR "/items/blaster/shot.wav
 const float Blaster::COOL_TIME = 0.5f;
 
 
+/*
+ *  Blaster class functions
+ *
+ */
+
+
+void Blaster::load_archetype(Archetype* const archetype, const VideoState& video_state)
+{
+    ENTER_FUNCTION(Blaster::load_archetype);
+
+    archetype->set_sprite(0, Entity::load_sprite(ANIMATION_FILENAME, DefaultWidth, DefaultHeight, video_state));
+    Video::set_color_key(archetype->sprite(0), 0, 255, 0);
+}
+
+
 /*
  *  Blaster methods
  *
@@ -120,6 +208,13 @@ const float Blaster::COOL_TIME = 0.5f;
 Blaster::Blaster(bool add) : Entity(add), m_cool_time(0.0f), m_shoot_sound_index(-1)
 {
     ENTER_FUNCTION(Blaster::Blaster);
+
+    set_type(this);
+    set_collision_layer(PickupLayer, layer_bit(PlayerLayer));
+
+    // this is more shots than can be on-screen at once with the cool down,
+    // plus the removed ones the rewind graveyard keeps alive
+    BlasterShot::reserve(MaxShots + static_cast<size_t>(Entity::graveyard_seconds() / COOL_TIME) + 1);
 }
 
 
@@ -131,8 +226,8 @@ void Blaster::shoot(const VideoState& video_state, const Skratch& skratch, const
 
     Audio::play_sound(m_shoot_sound_index);
 
-    new BlasterShot(skratch, world);
-    Entity::back()->load_media(video_state);
+    BlasterShot* const shot = new BlasterShot(skratch, world);
+    shot->use_shared_media(video_state);
 
     m_cool_time = COOL_TIME;
 }
@@ -157,8 +252,10 @@ void Blaster::load_sprites(const VideoState& video_state)
 {
     ENTER_FUNCTION(Blaster::load_sprites);
 
-    m_current_sprite_index = Entity::load_sprite(ANIMATION_FILENAME, DefaultWidth, DefaultHeight, video_state);
-    Video::set_color_key(m_current_sprite_index, 0, 255, 0);
+    use_archetype("blaster", load_archetype, video_state);
+    show(sprite(0));
+
+    BlasterShot::load_shared_media(video_state);
 }
 
 
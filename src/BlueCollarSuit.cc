@@ -27,6 +27,7 @@ Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
 #include "BlueCollarSuit.h"
 #include "Video.h"
 #include "Skratch.h"
+#include "state.h"
 
 
 /*
@@ -35,13 +36,58 @@ Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
  */
 
 
-const std::string BlueCollarSuit::IDLE_ANIMATION_FILENAME(DATADIR "/characters/bluecollarsuit/idle.tga");
-const std::string BlueCollarSuit::RUN1_ANIMATION_FILENAME(DATADIR "/characters/bluecollarsuit/run1.tga");
-const std::string BlueCollarSuit::RUN2_ANIMATION_FILENAME(DATADIR "/characters/bluecollarsuit/run2.tga");
+const std::string BlueCollarSuit::ANIMATION_DIRECTORY(DATADIR "/characters/bluecollarsuit");
+const std::string BlueCollarSuit::IDLE_CLIP("idle");
+const std::string BlueCollarSuit::RUN_CLIP("run");
 
 const float BlueCollarSuit::MASS = 1;
 const float BlueCollarSuit::MAX_HORIZONTAL_VEL = 75.0f;
 const float BlueCollarSuit::HORIZONTAL_ACCEL = 225.0f;
+const float BlueCollarSuit::JUMP_VEL = 600.0f;
+
+
+/*
+ *  BlueCollarSuit class functions
+ *
+ */
+
+
+void BlueCollarSuit::register_collision_handlers()
+{
+    ENTER_FUNCTION(BlueCollarSuit::register_collision_handlers);
+
+    Entity::set_collision_handler(EnemyLayer, ProjectileLayer, on_projectile_collision);
+}
+
+
+NavGraph::Mover BlueCollarSuit::navigation_mover(const VideoState& video_state)
+{
+    ENTER_FUNCTION(BlueCollarSuit::navigation_mover);
+
+    NavGraph::Mover mover;
+    mover.width = static_cast<int>(DefaultWidth * video_state.width_scale);
+    mover.height = static_cast<int>(DefaultHeight * video_state.height_scale);
+    mover.max_speed = MAX_HORIZONTAL_VEL;
+    mover.jump_velocity = JUMP_VEL;
+    return mover;
+}
+
+
+void BlueCollarSuit::on_projectile_collision(Entity* const entity, Entity* const projectile)
+{
+    ENTER_FUNCTION(BlueCollarSuit::on_projectile_collision);
+
+    entity->set_removable();
+    projectile->set_removable();
+}
+
+
+void BlueCollarSuit::load_archetype(Archetype* const archetype, const VideoState& video_state)
+{
+    ENTER_FUNCTION(BlueCollarSuit::load_archetype);
+
+    archetype->load_clips(ANIMATION_DIRECTORY, DefaultWidth, DefaultHeight, video_state);
+}
 
 
 /*
@@ -50,12 +96,14 @@ const float BlueCollarSuit::HORIZONTAL_ACCEL = 225.0f;
  */
 
 
-BlueCollarSuit::BlueCollarSuit() : Entity(), m_state(IdleRight)
+BlueCollarSuit::BlueCollarSuit()
+    : Entity(), m_state(IdleRight), m_on_ground(false), m_path_step(0), m_replan((rand() % ReplanThinks) + 1)
 {
     ENTER_FUNCTION(BlueCollarSuit::BlueCollarSuit);
 
-    m_mass = MASS;
-    memset(m_sprite_indexes, -1, AnimationCount * sizeof(int));
+    set_type(this);
+    set_mass(MASS);
+    set_collision_layer(EnemyLayer, layer_bit(PlayerLayer) | layer_bit(ProjectileLayer));
 //    memset(m_sound_indexes, -1, SoundCount * sizeof(int));
 }
 
@@ -63,6 +111,53 @@ BlueCollarSuit::BlueCollarSuit() : Entity(), m_state(IdleRight)
 void BlueCollarSuit::think(const World& world)
 {
     ENTER_FUNCTION(BlueCollarSuit::think);
+
+    // nothing can be changed in the air
+    const NavGraph& navigation = world.navigation();
+    if(navigation.empty() || !m_on_ground) return;
+
+    // suits are a block wide, so the column they're mostly in is the one they stand in
+    const Vector<float> p(position());
+    const int x = static_cast<int>((p.x() + (width() >> 1)) / world.block_width());
+    const int y = static_cast<int>((p.y() + height() - 1.0f) / world.block_height());
+    const int here = navigation.segment_at(x, y);
+
+    const Vector<float>& target(world.player_feet());
+    const int target_x = static_cast<int>(target.x() / world.block_width());
+
+    // the searches are spread out over the frames, since every suit starts at a different count
+    if(--m_replan <= 0) {
+        m_replan = ReplanThinks;
+        m_path_step = 0;
+
+        const int there = navigation.segment_at(target_x, static_cast<int>((target.y() - 1.0f) / world.block_height()));
+        if(here < 0 || there < 0 || !navigation.find_path(here, x, there, target_x, &m_search, &m_path))
+            m_path.clear();
+    }
+
+    // landing where the next edge goes means it's been taken
+    if(m_path_step < m_path.size() && here == navigation.edge(m_path[m_path_step]).to) ++m_path_step;
+
+    // on the same segment (or with no way to him), just go at him
+    if(m_path_step >= m_path.size()) {
+        run_toward(target.x());
+        return;
+    }
+
+    const NavGraph::Edge& edge = navigation.edge(m_path[m_path_step]);
+    const float takeoff = (edge.from_x + 0.5f) * world.block_width();
+    if(x != edge.from_x) {
+        run_toward(takeoff);
+        return;
+    }
+
+    const float direction = (edge.to_x > edge.from_x) ? 1.0f : -1.0f;
+    if(NavGraph::JumpEdge == edge.type) {
+        add_velocity_y(-JUMP_VEL);
+        set_velocity_x(direction * MAX_HORIZONTAL_VEL);
+        m_on_ground = false;
+    }
+    run_toward(takeoff + (direction * world.block_width()));
 }
 
 
@@ -70,17 +165,8 @@ void BlueCollarSuit::load_sprites(const VideoState& video_state)
 {
     ENTER_FUNCTION(BlueCollarSuit::load_sprites);
 
-    m_sprite_indexes[IdleRightAnimation] = Entity::load_sprite(IDLE_ANIMATION_FILENAME, DefaultWidth, DefaultHeight, video_state);
-    m_sprite_indexes[IdleLeftAnimation]  = Video::flip_surface_horizontal(m_sprite_indexes[IdleRightAnimation], "bluecollarsuit_idle_left");
-    m_sprite_indexes[Run1RightAnimation] = Entity::load_sprite(RUN1_ANIMATION_FILENAME, DefaultWidth, DefaultHeight, video_state);
-    m_sprite_indexes[Run2RightAnimation] = Entity::load_sprite(RUN2_ANIMATION_FILENAME, DefaultWidth, DefaultHeight, video_state);
-    m_sprite_indexes[Run1LeftAnimation]  = Video::flip_surface_horizontal(m_sprite_indexes[Run1RightAnimation], "bluecollarsuit_run1_left");
-    m_sprite_indexes[Run2LeftAnimation]  = Video::flip_surface_horizontal(m_sprite_indexes[Run2RightAnimation], "bluecollarsuit_run2_left");
-
-    for(int i=0; i<AnimationCount; ++i)
-        Video::set_color_key(m_sprite_indexes[i], 0, 255, 0);
-
-    m_current_sprite_index = m_sprite_indexes[IdleRightAnimation];
+    use_archetype("bluecollarsuit", load_archetype, video_state);
+    set_state(m_state);
 }
 
 
@@ -94,60 +180,44 @@ void BlueCollarSuit::on_animate(float dt, const std::bitset<World::CollisionSize
 {
     ENTER_FUNCTION(BlueCollarSuit::on_animate);
 
-    if(m_position.x() < 0.0f)
-        m_position.clear_x();
-    if((m_position.x() + width()) > world.pixel_width())
-        m_position.set_x(world.pixel_width() - width());
-    if(m_position.y() < 0.0f)
-        m_position.clear_y();
-    if((m_position.y() + height()) > world.pixel_height())
-        m_position.set_y(world.pixel_height() - height());
+    const Vector<float> p(position());
+    if(p.x() < 0.0f)
+        set_position_x(0.0f);
+    if((p.x() + width()) > world.pixel_width())
+        set_position_x(world.pixel_width() - width());
+    if(p.y() < 0.0f)
+        set_position_y(0.0f);
+    if((p.y() + height()) > world.pixel_height())
+        set_position_y(world.pixel_height() - height());
 
-    // don't go too fast
-    if(m_velocity.x() > MAX_HORIZONTAL_VEL)
-        m_velocity.set_x(MAX_HORIZONTAL_VEL);
-    else if(m_velocity.x() < -MAX_HORIZONTAL_VEL)
-        m_velocity.set_x(-MAX_HORIZONTAL_VEL);
+    m_on_ground = collision_types[World::BottomCollision];
 
-    m_animation_seconds += dt;
-    switch(m_state)
-    {
-    case RunningLeft:
-        if(m_animation_seconds >= 0.0f && m_animation_seconds < 0.25f)
-            m_current_sprite_index = m_sprite_indexes[Run1LeftAnimation];
-        else if(m_animation_seconds >= 0.25f && m_animation_seconds < 0.5f)
-            m_current_sprite_index = m_sprite_indexes[IdleLeftAnimation];
-        else if(m_animation_seconds >= 0.5f && m_animation_seconds < 0.75f)
-            m_current_sprite_index = m_sprite_indexes[Run2LeftAnimation];
-        else if(m_animation_seconds >= 0.75f && m_animation_seconds < 1.0f)
-            m_current_sprite_index = m_sprite_indexes[IdleLeftAnimation];
-        else
-            m_animation_seconds = 0.0f;
-        break;
-    case RunningRight:
-        if(m_animation_seconds >= 0.0f && m_animation_seconds < 0.25f)
-            m_current_sprite_index = m_sprite_indexes[Run1RightAnimation];
-        else if(m_animation_seconds >= 0.25f && m_animation_seconds < 0.5f)
-            m_current_sprite_index = m_sprite_indexes[IdleRightAnimation];
-        else if(m_animation_seconds >= 0.5f && m_animation_seconds < 0.75f)
-            m_current_sprite_index = m_sprite_indexes[Run2RightAnimation];
-        else if(m_animation_seconds >= 0.75f && m_animation_seconds < 1.0f)
-            m_current_sprite_index = m_sprite_indexes[IdleRightAnimation];
-        else
-            m_animation_seconds = 0.0f;
-        break;
-    default: break;
-    }
+    // don't go too fast
+    const Vector<float> v(velocity());
+    if(v.x() > MAX_HORIZONTAL_VEL)
+        set_velocity_x(MAX_HORIZONTAL_VEL);
+    else if(v.x() < -MAX_HORIZONTAL_VEL)
+        set_velocity_x(-MAX_HORIZONTAL_VEL);
 }
 
 
-void BlueCollarSuit::on_collision(Entity* const entity)
+void BlueCollarSuit::run_toward(float x)
 {
-    ENTER_FUNCTION(BlueCollarSuit::on_collision);
-
-    if(typeid(*entity) == typeid(Blaster::BlasterShot)) {
-        set_removable();
-        entity->set_removable();
+    ENTER_FUNCTION(BlueCollarSuit::run_toward);
+
+    const float offset = x - (position().x() + (width() >> 1));
+    if(std::fabs(offset) < 2.0f) {
+        set_acceleration_x(0.0f);
+        set_velocity_x(0.0f);
+
+        if(m_state == RunningRight) set_state(IdleRight);
+        else if(m_state == RunningLeft) set_state(IdleLeft);
+    } else if(offset > 0.0f) {
+        set_acceleration_x(HORIZONTAL_ACCEL);
+        if(m_state != RunningRight) set_state(RunningRight);
+    } else {
+        set_acceleration_x(-HORIZONTAL_ACCEL);
+        if(m_state != RunningLeft) set_state(RunningLeft);
     }
 }
 
@@ -159,21 +229,18 @@ void BlueCollarSuit::set_state(int state)
     switch(state)
     {
     case IdleLeft:
-        m_current_sprite_index = m_sprite_indexes[IdleLeftAnimation];
+        play(IDLE_CLIP, true);
         break;
     case IdleRight:
-        m_current_sprite_index = m_sprite_indexes[IdleRightAnimation];
+        play(IDLE_CLIP, false);
         break;
     case RunningLeft:
-        m_current_sprite_index = m_sprite_indexes[Run1LeftAnimation];
+        play(RUN_CLIP, true);
         break;
     case RunningRight:
-        m_current_sprite_index = m_sprite_indexes[Run1RightAnimation];
+        play(RUN_CLIP, false);
         break;
     default: return;
     }
-
-    if(state != m_state)
-        m_animation_seconds = 0.0f;
     m_state = static_cast<BlueCollarSuitState>(state);
 }
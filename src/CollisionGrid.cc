@@ -0,0 +1,237 @@
+/**
+\file CollisionGrid.cc
+\author Shane Lillie
+\brief Bit packed collision grid source.
+
+\verbatim
+Copyright 2002-2003 Energon Software
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2, or (at your option)
+any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software Foundation,
+Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+\endverbatim
+*/
+
+
+
+#include "shared.h"
+#include "CollisionGrid.h"
+
+
+/*
+ *  CollisionGrid functions
+ *
+ */
+
+
+/* the bits [first, last] of a word */
+inline Uint64 word_mask(int first, int last)
+{
+    const Uint64 all = ~static_cast<Uint64>(0);
+    return (all << first) & (all >> (63 - last));
+}
+
+
+inline int popcount(Uint64 v)
+{
+#if defined __GNUC__
+    return __builtin_popcountll(v);
+#else
+    int count = 0;
+    for(; v; ++count) v &= v - 1;
+    return count;
+#endif
+}
+
+
+/* the lowest set bit of a word that isn't 0 */
+inline int lowest_bit(Uint64 v)
+{
+#if defined __GNUC__
+    return __builtin_ctzll(v);
+#else
+    int bit = 0;
+    for(; !(v & 1); v >>= 1) ++bit;
+    return bit;
+#endif
+}
+
+
+/*
+ *  CollisionGrid class functions
+ *
+ */
+
+
+CollisionGrid::CollisionGrid()
+    : m_width(0), m_height(0), m_words(0), m_summary_width(0), m_summary_height(0), m_summary_words(0)
+{
+    ENTER_FUNCTION(CollisionGrid::CollisionGrid);
+}
+
+
+void CollisionGrid::resize(int width, int height)
+{
+    ENTER_FUNCTION(CollisionGrid::resize);
+
+    m_width = std::max(0, width);
+    m_height = std::max(0, height);
+    m_words = (m_width + 63) >> 6;
+    m_bits.assign(m_words * m_height, 0);
+
+    m_summary_width = (m_width + SummarySize - 1) / SummarySize;
+    m_summary_height = (m_height + SummarySize - 1) / SummarySize;
+    m_summary_words = (m_summary_width + 63) >> 6;
+    m_summary.assign(m_summary_words * m_summary_height, 0);
+}
+
+
+void CollisionGrid::set_row(int y, const byte* const bits)
+{
+    if(y < 0 || y >= m_height) return;
+
+    // the words are little endian, so this is a straight copy on most machines
+    Uint64* const row = &m_bits[y * m_words];
+    for(int w=0; w<m_words; ++w) {
+        const byte* const b = bits + (w << 3);
+        row[w] = static_cast<Uint64>(b[0]) | (static_cast<Uint64>(b[1]) << 8)
+            | (static_cast<Uint64>(b[2]) << 16) | (static_cast<Uint64>(b[3]) << 24)
+            | (static_cast<Uint64>(b[4]) << 32) | (static_cast<Uint64>(b[5]) << 40)
+            | (static_cast<Uint64>(b[6]) << 48) | (static_cast<Uint64>(b[7]) << 56);
+    }
+
+    // nothing past the right edge is allowed to be set
+    if(m_width & 63) row[m_words - 1] &= word_mask(0, (m_width & 63) - 1);
+}
+
+
+void CollisionGrid::set(int x, int y, bool collidable)
+{
+    ENTER_FUNCTION(CollisionGrid::set);
+
+    if(x < 0 || y < 0 || x >= m_width || y >= m_height) return;
+
+    const Uint64 bit = static_cast<Uint64>(1) << (x & 63);
+    if(collidable) m_bits[(y * m_words) + (x >> 6)] |= bit;
+    else m_bits[(y * m_words) + (x >> 6)] &= ~bit;
+
+    // the block is only empty now if nothing else in it is collidable
+    const int sx = x / SummarySize, sy = y / SummarySize;
+    bool any_set = collidable;
+    for(int by=sy*SummarySize; !any_set && by<std::min(m_height, (sy + 1) * SummarySize); ++by)
+        any_set = span_first(m_bits, m_words, by, sx * SummarySize, std::min(m_width, (sx + 1) * SummarySize) - 1) >= 0;
+
+    const Uint64 summary_bit = static_cast<Uint64>(1) << (sx & 63);
+    if(any_set) m_summary[(sy * m_summary_words) + (sx >> 6)] |= summary_bit;
+    else m_summary[(sy * m_summary_words) + (sx >> 6)] &= ~summary_bit;
+}
+
+
+unsigned int CollisionGrid::hash() const
+{
+    // FNV-1a over the words, and the size so an empty grid of another size doesn't match
+    unsigned int h = 2166136261u;
+    h = (h ^ static_cast<unsigned int>(m_width)) * 16777619u;
+    h = (h ^ static_cast<unsigned int>(m_height)) * 16777619u;
+    for(std::vector<Uint64>::const_iterator it = m_bits.begin(); it != m_bits.end(); ++it) {
+        h = (h ^ static_cast<unsigned int>(*it)) * 16777619u;
+        h = (h ^ static_cast<unsigned int>(*it >> 32)) * 16777619u;
+    }
+    return h;
+}
+
+
+void CollisionGrid::update_summary()
+{
+    ENTER_FUNCTION(CollisionGrid::update_summary);
+
+    std::fill(m_summary.begin(), m_summary.end(), 0);
+    for(int sy=0; sy<m_summary_height; ++sy) {
+        const int last_y = std::min(m_height, (sy + 1) * SummarySize) - 1;
+        for(int sx=0; sx<m_summary_width; ++sx) {
+            const int x0 = sx * SummarySize;
+            const int x1 = std::min(m_width, x0 + SummarySize) - 1;
+            for(int y=sy*SummarySize; y<=last_y; ++y) {
+                if(span_first(m_bits, m_words, y, x0, x1) >= 0) {
+                    m_summary[(sy * m_summary_words) + (sx >> 6)] |= static_cast<Uint64>(1) << (sx & 63);
+                    break;
+                }
+            }
+        }
+    }
+}
+
+
+int CollisionGrid::count(int y, int x0, int x1) const
+{
+    if(y < 0 || y >= m_height) return 0;
+
+    x0 = std::max(x0, 0);
+    x1 = std::min(x1, m_width - 1);
+    if(x0 > x1) return 0;
+
+    const Uint64* const row = &m_bits[y * m_words];
+    const int first_word = x0 >> 6, last_word = x1 >> 6;
+    if(first_word == last_word)
+        return popcount(row[first_word] & word_mask(x0 & 63, x1 & 63));
+
+    int total = popcount(row[first_word] & word_mask(x0 & 63, 63));
+    for(int w=first_word+1; w<last_word; ++w)
+        total += popcount(row[w]);
+    return total + popcount(row[last_word] & word_mask(0, x1 & 63));
+}
+
+
+int CollisionGrid::first(int y, int x0, int x1) const
+{
+    if(y < 0 || y >= m_height) return -1;
+    return span_first(m_bits, m_words, y, std::max(x0, 0), std::min(x1, m_width - 1));
+}
+
+
+bool CollisionGrid::any(int x0, int y0, int x1, int y1) const
+{
+    x0 = std::max(x0, 0);
+    y0 = std::max(y0, 0);
+    x1 = std::min(x1, m_width - 1);
+    y1 = std::min(y1, m_height - 1);
+    if(x0 > x1 || y0 > y1) return false;
+
+    // only the rows of the blocks the summary says have something are looked at
+    const int sx0 = x0 / SummarySize, sx1 = x1 / SummarySize;
+    for(int sy=y0/SummarySize; sy<=y1/SummarySize; ++sy) {
+        if(span_first(m_summary, m_summary_words, sy, sx0, sx1) < 0) continue;
+
+        const int last_y = std::min(y1, ((sy + 1) * SummarySize) - 1);
+        for(int y=std::max(y0, sy * SummarySize); y<=last_y; ++y) {
+            if(span_first(m_bits, m_words, y, x0, x1) >= 0)
+                return true;
+        }
+    }
+    return false;
+}
+
+
+int CollisionGrid::span_first(const std::vector<Uint64>& bits, int words, int y, int x0, int x1)
+{
+    if(x0 > x1) return -1;
+
+    const Uint64* const row = &bits[y * words];
+    const int last_word = x1 >> 6;
+    for(int w=x0>>6; w<=last_word; ++w) {
+        const Uint64 mask = word_mask((w == (x0 >> 6)) ? (x0 & 63) : 0, (w == last_word) ? (x1 & 63) : 63);
+        const Uint64 hits = row[w] & mask;
+        if(hits) return (w << 6) + lowest_bit(hits);
+    }
+    return -1;
+}
@@ -0,0 +1,157 @@
+/**
+\file DirtyRects.cc
+\author Shane Lillie
+\brief Dirty rectangle tracking source.
+
+\verbatim
+Copyright 2002-2003 Energon Software
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2, or (at your option)
+any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software Foundation,
+Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+\endverbatim
+*/
+
+
+#include "shared.h"
+#include "DirtyRects.h"
+#include "Video.h"
+
+
+/*
+ *  functions
+ *
+ */
+
+
+inline bool overlaps(const SDL_Rect& a, const SDL_Rect& b)
+{
+    return a.x <= b.x + b.w && b.x <= a.x + a.w && a.y <= b.y + b.h && b.y <= a.y + a.h;
+}
+
+
+/*
+ *  DirtyRects class functions
+ *
+ */
+
+
+void DirtyRects::merge(std::vector<SDL_Rect>* const rects)
+{
+    ENTER_FUNCTION(DirtyRects::merge);
+
+    // there's only ever a handful of sprites, so the quadratic pass is fine
+    bool merged = true;
+    while(merged) {
+        merged = false;
+        for(size_t i=0; i<rects->size(); ++i) {
+            for(size_t j=i+1; j<rects->size(); ++j) {
+                SDL_Rect& a = (*rects)[i];
+                const SDL_Rect& b = (*rects)[j];
+                if(!overlaps(a, b)) continue;
+
+                const int left = std::min(a.x, b.x), top = std::min(a.y, b.y);
+                const int right = std::max(a.x + a.w, b.x + b.w), bottom = std::max(a.y + a.h, b.y + b.h);
+                a.x = left; a.y = top;
+                a.w = right - left; a.h = bottom - top;
+
+                (*rects)[j] = rects->back();
+                rects->pop_back();
+                merged = true;
+                --j;
+            }
+        }
+    }
+}
+
+
+int DirtyRects::area(const std::vector<SDL_Rect>& rects)
+{
+    int total = 0;
+    for(std::vector<SDL_Rect>::const_iterator it = rects.begin(); it != rects.end(); ++it)
+        total += it->w * it->h;
+    return total;
+}
+
+
+/*
+ *  DirtyRects methods
+ *
+ */
+
+
+DirtyRects::DirtyRects()
+    : m_valid(false), m_full(true), m_window_width(0), m_window_height(0)
+{
+}
+
+
+bool DirtyRects::begin_frame(const Vector<int>& camera)
+{
+    ENTER_FUNCTION(DirtyRects::begin_frame);
+
+    // a double buffered window doesn't keep last frame around to patch
+    m_full = !m_valid || camera != m_camera || Video::double_buffered()
+        || m_window_width != Video::window_width() || m_window_height != Video::window_height();
+
+    m_camera = camera;
+    m_window_width = Video::window_width();
+    m_window_height = Video::window_height();
+
+    m_damaged.swap(m_drawn);
+    m_drawn.clear();
+    if(m_full) m_damaged.clear();
+    else {
+        merge(&m_damaged);
+        if(area(m_damaged) * 100 > m_window_width * m_window_height * MaxDirtyPercent) {
+            m_damaged.clear();
+            m_full = true;
+        }
+    }
+    return m_full;
+}
+
+
+void DirtyRects::add(const SDL_Rect& rect)
+{
+    const int left = std::max(0, static_cast<int>(rect.x));
+    const int top = std::max(0, static_cast<int>(rect.y));
+    const int right = std::min(m_window_width, rect.x + rect.w);
+    const int bottom = std::min(m_window_height, rect.y + rect.h);
+    if(right <= left || bottom <= top) return;
+
+    SDL_Rect r;
+    r.x = left; r.y = top;
+    r.w = right - left; r.h = bottom - top;
+    m_drawn.push_back(r);
+}
+
+
+void DirtyRects::present()
+{
+    ENTER_FUNCTION(DirtyRects::present);
+
+    m_valid = true;
+    if(m_full) {
+        Video::flip();
+        return;
+    }
+
+    // last frame's areas have to go out too, or whatever moved off of them stays on screen
+    m_present.assign(m_damaged.begin(), m_damaged.end());
+    m_present.insert(m_present.end(), m_drawn.begin(), m_drawn.end());
+    merge(&m_present);
+
+    if(area(m_present) * 100 > m_window_width * m_window_height * MaxDirtyPercent) Video::flip();
+    else if(!m_present.empty()) Video::update_rects(m_present);
+}
@@ -25,7 +25,11 @@ Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
 
 #include "shared.h"
 #include "Entity.h"
+#include "EntityTypes.h"
+#include "Physics.h"
+#include "SpatialHash.h"
 #include "Video.h"
+#include "WorkerPool.h"
 #include "World.h"
 #include "state.h"
 
@@ -36,7 +40,79 @@ Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
  */
 
 
-std::list<Entity*> Entity::entities;
+SlotMap<Entity*> Entity::entities;
+std::vector<Entity*> Entity::removed;
+
+std::deque<std::pair<unsigned int, Entity*> > Entity::graveyard;
+unsigned int Entity::graveyard_frames = 0;
+unsigned int Entity::graveyard_frames_per_second = 1;
+unsigned int Entity::cleanup_frame = 0;
+std::map<int, std::vector<Entity*> > Entity::draw_layers;
+
+Entity::CollisionHandler Entity::collision_handlers[CollisionLayerCount][CollisionLayerCount];
+
+SpatialHash Entity::broadphase;
+std::vector<Entity*> Entity::candidates;
+unsigned long Entity::pairs_tested = 0;
+unsigned long Entity::pairs_possible = 0;
+
+int Entity::active_blocks = 4;
+int Entity::warm_blocks = 32;
+int Entity::hysteresis_blocks = 2;
+int Entity::warm_interval = 4;
+unsigned int Entity::activity_frame = 0;
+unsigned int Entity::next_activity_phase = 0;
+unsigned int Entity::next_id = 0;
+int Entity::activity_counts[ActivityTierCount];
+
+std::vector<std::vector<Entity::Command> > Entity::commands;
+
+
+/*
+ *  Entity functions
+ *
+ */
+
+
+template <class T>
+void append(std::vector<unsigned char>* const frame, const T& value)
+{
+    const unsigned char* const bytes = reinterpret_cast<const unsigned char*>(&value);
+    frame->insert(frame->end(), bytes, bytes + sizeof(T));
+}
+
+
+template <class T>
+void append_array(std::vector<unsigned char>* const frame, const std::vector<T>& values)
+{
+    if(values.empty()) return;
+
+    const unsigned char* const bytes = reinterpret_cast<const unsigned char*>(&values[0]);
+    frame->insert(frame->end(), bytes, bytes + values.size() * sizeof(T));
+}
+
+
+template <class T>
+bool read(const std::vector<unsigned char>& frame, size_t* const pos, T* const value)
+{
+    if(*pos + sizeof(T) > frame.size()) return false;
+
+    memcpy(value, &frame[*pos], sizeof(T));
+    *pos += sizeof(T);
+    return true;
+}
+
+
+template <class T>
+bool read_array(const std::vector<unsigned char>& frame, size_t* const pos, int count, std::vector<T>* const values)
+{
+    if(count < 0 || *pos + count * sizeof(T) > frame.size()) return false;
+
+    values->resize(count);
+    if(count) memcpy(&(*values)[0], &frame[*pos], count * sizeof(T));
+    *pos += count * sizeof(T);
+    return true;
+}
 
 
 /*
@@ -45,21 +121,44 @@ std::list<Entity*> Entity::entities;
  */
 
 
-void Entity::push_back(Entity* const entity)
+void Entity::set_collision_handler(CollisionLayer layer, CollisionLayer other, CollisionHandler handler)
 {
-    ENTER_FUNCTION(Entity::push_back);
+    ENTER_FUNCTION(Entity::set_collision_handler);
+
+    collision_handlers[layer][other] = handler;
+}
+
+
+void Entity::set_activity_regions(int active, int warm, int hysteresis, int interval)
+{
+    ENTER_FUNCTION(Entity::set_activity_regions);
 
-    entities.push_back(entity);
+    active_blocks = std::max(0, active);
+    warm_blocks = std::max(active_blocks, warm);
+    hysteresis_blocks = std::max(0, hysteresis);
+    warm_interval = std::max(1, interval);
 }
 
 
-Entity* const Entity::back()
+Entity::Handle Entity::push_back(Entity* const entity)
 {
-    ENTER_FUNCTION(Entity::back);
+    ENTER_FUNCTION(Entity::push_back);
+
+    entity->m_handle = entities.insert(entity);
+    Physics::flags[entity->m_physics_slot] |= Physics::Listed;
+    Animation::awake[entity->m_animation_slot] = 1;
 
-    if(!entities.size())
-        return NULL;
-    return entities.back();
+    draw_layers[entity->m_draw_layer].push_back(entity);
+    entity->m_drawn = true;
+
+    return entity->m_handle;
+}
+
+
+Entity* const Entity::get(const Handle& handle)
+{
+    Entity* const* const entity = entities.get(handle);
+    return entity ? *entity : NULL;
 }
 
 
@@ -67,11 +166,11 @@ void Entity::all_think(const World& world)
 {
     ENTER_FUNCTION(Entity::all_think);
 
-    for(std::list<Entity*>::iterator it = entities.begin(); it != entities.end(); ++it) {
-        if(*it && !(*it)->removable()) {
-            (*it)->think(world);
-        }
-    }
+    update_activity(world);
+
+    if(WorkerPool::threads())
+        commands.resize(WorkerPool::threads());
+    think_types(world, EntityTypes());
 }
 
 
@@ -79,11 +178,24 @@ void Entity::all_animate(float dt, const World& world)
 {
     ENTER_FUNCTION(Entity::all_animate);
 
-    for(std::list<Entity*>::iterator it = entities.begin(); it != entities.end(); ++it) {
-        if(*it && !(*it)->removable()) {
-            (*it)->animate(dt, world);
+    // step the kinematics for everything in one pass over the physics arrays
+    if(WorkerPool::threads())
+        WorkerPool::run(integrate_chunk, Physics::size(), &dt);
+    else Physics::integrate(dt);
+
+    // rebuild the broadphase once for the whole frame
+    broadphase.clear(world.block_width(), world.block_height(), entities.size());
+    for(int i=0; i<Physics::size(); ++i) {
+        if(Physics::simulated(i)) {
+            Physics::owner[i]->insert_broadphase();
         }
     }
+    pairs_tested = pairs_possible = 0;
+
+    resolve_types(world, EntityTypes());
+
+    // and pick everyone's next frame in one pass over the animation arrays
+    Animation::advance(dt);
 }
 
 
@@ -91,23 +203,21 @@ void Entity::cleanup()
 {
     ENTER_FUNCTION(Entity::cleanup);
 
-    for(std::list<Entity*>::iterator it = entities.begin(); it != entities.end(); ++it) {
-        if(*it) {
-            if((*it)->removable()) {
-                delete (*it);
-                *it = NULL;
-            }
-        }
-    }
-    entities.remove(NULL);
-}
+    ++cleanup_frame;
 
+    // only the removed entities are touched, the rest stay where they are
+    for(std::vector<Entity*>::iterator it = removed.begin(); it != removed.end(); ++it) {
+        unlist(*it);
+        if(graveyard_frames) graveyard.push_back(std::make_pair(cleanup_frame, *it));
+        else delete (*it);
+    }
+    removed.clear();
 
-void Entity::sort()
-{
-    ENTER_FUNCTION(Entity::sort);
-
-    entities.sort();
+    // a rewind can leave younger entities in front, they just wait a little longer
+    while(!graveyard.empty() && graveyard.front().first + graveyard_frames < cleanup_frame) {
+        delete graveyard.front().second;
+        graveyard.pop_front();
+    }
 }
 
 
@@ -115,8 +225,8 @@ void Entity::render_entities(const World& world)
 {
     ENTER_FUNCTION(Entity::render_entities);
 
-    for(std::list<Entity*>::iterator it = entities.begin(); it != entities.end(); ++it) {
-        if(*it) {
+    for(std::map<int, std::vector<Entity*> >::const_iterator layer = draw_layers.begin(); layer != draw_layers.end(); ++layer) {
+        for(std::vector<Entity*>::const_iterator it = layer->second.begin(); it != layer->second.end(); ++it) {
             (*it)->render(world);
         }
     }
@@ -127,11 +237,163 @@ void Entity::free_entities()
 {
     ENTER_FUNCTION(Entity::free_entities);
 
-    for(std::list<Entity*>::iterator it = entities.begin(); it != entities.end(); ++it) {
-        if(*it) delete (*it);
-        *it = NULL;
+    // everything is going, so don't let each entity dig itself out of its layer
+    draw_layers.clear();
+
+    for(size_t i=0; i<entities.size(); ++i) {
+        Entity* const entity = entities[i];
+        if(entity->m_release_type) entity->m_release_type(entity->m_type_handle);
+        delete entity;
     }
     entities.clear();
+    removed.clear();
+
+    for(std::deque<std::pair<unsigned int, Entity*> >::iterator it = graveyard.begin(); it != graveyard.end(); ++it)
+        delete it->second;
+    graveyard.clear();
+}
+
+
+void Entity::set_graveyard_frames(int frames, int frames_per_second)
+{
+    ENTER_FUNCTION(Entity::set_graveyard_frames);
+
+    graveyard_frames = std::max(0, frames);
+    graveyard_frames_per_second = std::max(1, frames_per_second);
+}
+
+
+void Entity::save_state(std::vector<unsigned char>* const frame)
+{
+    ENTER_FUNCTION(Entity::save_state);
+
+    // whole arrays at a time, so each field that didn't change is one run of the delta
+    append(frame, cleanup_frame);
+
+    // owners go in by id, a pointer wouldn't mean anything outside of this process
+    const int count = Physics::size();
+    std::vector<unsigned int> ids(count);
+    for(int i=0; i<count; ++i)
+        ids[i] = Physics::owner[i]->m_id;
+
+    append(frame, count);
+    append_array(frame, ids);
+    append_array(frame, Physics::position_x);
+    append_array(frame, Physics::position_y);
+    append_array(frame, Physics::velocity_x);
+    append_array(frame, Physics::velocity_y);
+    append_array(frame, Physics::acceleration_x);
+    append_array(frame, Physics::acceleration_y);
+    append_array(frame, Physics::elapsed);
+    append_array(frame, Physics::flags);
+
+    // and clips and sprites by where they are in the owner's archetype
+    const int animation_count = Animation::size();
+    std::vector<int> clips(animation_count), sprites(animation_count);
+    ids.resize(animation_count);
+    for(int i=0; i<animation_count; ++i) {
+        const Entity* const entity = Animation::owner[i];
+        ids[i] = entity->m_id;
+        clips[i] = entity->m_archetype ? entity->m_archetype->find_clip(Animation::clip[i]) : -1;
+        sprites[i] = entity->m_archetype ? entity->m_archetype->find_sprite(Animation::sprite[i]) : -1;
+    }
+
+    append(frame, animation_count);
+    append_array(frame, ids);
+    append_array(frame, clips);
+    append_array(frame, Animation::seconds);
+    append_array(frame, sprites);
+}
+
+
+bool Entity::load_state(const std::vector<unsigned char>& frame, size_t offset)
+{
+    ENTER_FUNCTION(Entity::load_state);
+
+    assert(removed.empty());
+
+    size_t pos = offset;
+    unsigned int saved_cleanup_frame = 0;
+    int count = 0;
+    if(!read(frame, &pos, &saved_cleanup_frame) || !read(frame, &pos, &count)) return false;
+
+    std::vector<unsigned int> owner;
+    std::vector<float> position_x, position_y, velocity_x, velocity_y, acceleration_x, acceleration_y, elapsed;
+    std::vector<unsigned char> flags;
+    if(!read_array(frame, &pos, count, &owner)
+        || !read_array(frame, &pos, count, &position_x) || !read_array(frame, &pos, count, &position_y)
+        || !read_array(frame, &pos, count, &velocity_x) || !read_array(frame, &pos, count, &velocity_y)
+        || !read_array(frame, &pos, count, &acceleration_x) || !read_array(frame, &pos, count, &acceleration_y)
+        || !read_array(frame, &pos, count, &elapsed) || !read_array(frame, &pos, count, &flags))
+        return false;
+
+    int animation_count = 0;
+    std::vector<unsigned int> animation_owner;
+    std::vector<int> clip;
+    std::vector<float> seconds;
+    std::vector<int> sprite;
+    if(!read(frame, &pos, &animation_count) || !read_array(frame, &pos, animation_count, &animation_owner)
+        || !read_array(frame, &pos, animation_count, &clip) || !read_array(frame, &pos, animation_count, &seconds)
+        || !read_array(frame, &pos, animation_count, &sprite))
+        return false;
+
+    // graveyard ages follow the timeline, so nothing a frame still refers to gets deleted
+    cleanup_frame = saved_cleanup_frame;
+
+    // revive() and unlist() don't move anyone's slots, so this stays good
+    std::map<unsigned int, int> slots;
+    for(int i=0; i<Physics::size(); ++i)
+        slots[Physics::owner[i]->m_id] = i;
+    std::vector<unsigned char> seen(Physics::size(), 0);
+
+    for(int i=0; i<count; ++i) {
+        const std::map<unsigned int, int>::const_iterator it = slots.find(owner[i]);
+        if(it == slots.end()) continue;
+
+        const int slot = it->second;
+        Entity* const entity = Physics::owner[slot];
+        seen[slot] = 1;
+
+        const bool was_listed = (flags[i] & Physics::Listed) != 0;
+        const bool listed = entities.contains(entity->m_handle);
+        if(was_listed && !listed) {
+            revive(entity);
+        } else if(!was_listed && listed) {
+            unlist(entity);
+            graveyard.push_back(std::make_pair(cleanup_frame, entity));
+        }
+
+        Physics::position_x[slot] = position_x[i];
+        Physics::position_y[slot] = position_y[i];
+        Physics::velocity_x[slot] = velocity_x[i];
+        Physics::velocity_y[slot] = velocity_y[i];
+        Physics::acceleration_x[slot] = acceleration_x[i];
+        Physics::acceleration_y[slot] = acceleration_y[i];
+        Physics::elapsed[slot] = elapsed[i];
+        Physics::flags[slot] = flags[i];
+    }
+
+    // anything listed that the frame doesn't know about was added after it
+    for(int i=0; i<Physics::size(); ++i) {
+        Entity* const entity = Physics::owner[i];
+        if(seen[i] || !entities.contains(entity->m_handle)) continue;
+
+        Physics::flags[i] |= Physics::Removed;
+        unlist(entity);
+        graveyard.push_back(std::make_pair(cleanup_frame, entity));
+    }
+
+    for(int i=0; i<animation_count; ++i) {
+        const std::map<unsigned int, int>::const_iterator it = slots.find(animation_owner[i]);
+        if(it == slots.end()) continue;
+
+        const Entity* const entity = Physics::owner[it->second];
+        const int slot = entity->m_animation_slot;
+        Animation::clip[slot] = entity->m_archetype ? entity->m_archetype->clip(clip[i]) : NULL;
+        Animation::seconds[slot] = seconds[i];
+        Animation::sprite[slot] = entity->m_archetype ? entity->m_archetype->sprite(sprite[i]) : -1;
+    }
+    return true;
 }
 
 
@@ -141,9 +403,204 @@ void Entity::print_entities(std::ostream& out)
 
     out << "I have " << entities.size() << " entities" << std::endl;
 
-    int i=0;
-    for(std::list<Entity*>::const_iterator it = entities.begin(); it != entities.end(); ++it)
-        out << i++ << ": " << typeid(*(*it)).name() << std::endl;
+    for(size_t i=0; i<entities.size(); ++i)
+        out << i << ": " << typeid(*entities[i]).name() << std::endl;
+
+    out << "Broadphase tested " << pairs_tested << " of " << pairs_possible << " entity pairs last frame" << std::endl;
+    out << "Last frame had " << activity_counts[ActiveTier] << " active, "
+        << activity_counts[WarmTier] << " warm and "
+        << activity_counts[FrozenTier] << " frozen entities" << std::endl;
+}
+
+
+template <class H, class T>
+void Entity::think_types(const World& world, TypeList<H, T>)
+{
+    think_type<H>(world);
+    think_types(world, T());
+}
+
+
+template <class T>
+void Entity::think_type(const World& world)
+{
+    const int count = static_cast<int>(TypedEntities<T>::entities.size());
+    if(WorkerPool::threads()) {
+        WorkerPool::run(think_chunk<T>, count, &world);
+        apply_commands();
+        return;
+    }
+    think_chunk<T>(0, count, -1, &world);
+}
+
+
+template <class T>
+void Entity::think_chunk(int begin, int end, int chunk, const void* data)
+{
+    const World& world = *static_cast<const World*>(data);
+    const SlotMap<T*>& list = TypedEntities<T>::entities;
+    for(int i=begin; i<end; ++i) {
+        T* const entity = list[i];
+        if(!entity->removable() && Physics::stepping(entity->m_physics_slot)) {
+            // qualified, so there's no virtual call
+            entity->T::think(world);
+        }
+    }
+}
+
+
+template <class H, class T>
+void Entity::resolve_types(const World& world, TypeList<H, T>)
+{
+    resolve_type<H>(world);
+    resolve_types(world, T());
+}
+
+
+template <class T>
+void Entity::resolve_type(const World& world)
+{
+    // collision handlers can add entities, so the size is checked every time
+    const SlotMap<T*>& list = TypedEntities<T>::entities;
+    for(size_t i=0; i<list.size(); ++i) {
+        T* const entity = list[i];
+        if(!entity->removable() && Physics::stepping(entity->m_physics_slot)) {
+            // warm entities catch up on all the time since they last ran
+            const int slot = entity->m_physics_slot;
+            const float dt = Physics::elapsed[slot];
+            const std::bitset<World::CollisionSize> wc = entity->resolve(dt, world);
+            entity->T::on_animate(dt, wc, world);
+            Physics::elapsed[slot] = 0.0f;
+        }
+    }
+}
+
+
+void Entity::integrate_chunk(int begin, int end, int chunk, const void* data)
+{
+    Physics::integrate(*static_cast<const float*>(data), begin, end);
+}
+
+
+void Entity::apply_commands()
+{
+    ENTER_FUNCTION(Entity::apply_commands);
+
+    for(std::vector<std::vector<Command> >::iterator buffer = commands.begin(); buffer != commands.end(); ++buffer) {
+        for(std::vector<Command>::const_iterator it = buffer->begin(); it != buffer->end(); ++it) {
+            switch(it->type)
+            {
+            case Command::Remove:
+                mark_removed(it->entity);
+                break;
+            }
+        }
+        buffer->clear();
+    }
+}
+
+
+void Entity::reserve_stores(size_t count)
+{
+    ENTER_FUNCTION(Entity::reserve_stores);
+
+    entities.reserve(entities.size() + count);
+    Physics::reserve(Physics::size() + static_cast<int>(count));
+    Animation::reserve(Animation::size() + static_cast<int>(count));
+
+    // new entities start out on layer 0 (see the constructor)
+    std::vector<Entity*>& layer = draw_layers[0];
+    layer.reserve(layer.size() + count);
+}
+
+
+void Entity::unlist(Entity* const entity)
+{
+    ENTER_FUNCTION(Entity::unlist);
+
+    if(entity->m_release_type) entity->m_release_type(entity->m_type_handle);
+    entities.erase(entity->m_handle);
+    entity->remove_from_draw_layer();
+
+    Physics::flags[entity->m_physics_slot] &= ~Physics::Listed;
+    Animation::awake[entity->m_animation_slot] = 0;
+}
+
+
+void Entity::revive(Entity* const entity)
+{
+    ENTER_FUNCTION(Entity::revive);
+
+    for(std::deque<std::pair<unsigned int, Entity*> >::iterator it = graveyard.begin(); it != graveyard.end(); ++it) {
+        if(it->second == entity) {
+            graveyard.erase(it);
+            break;
+        }
+    }
+
+    Physics::flags[entity->m_physics_slot] &= ~Physics::Removed;
+    push_back(entity);
+    if(entity->m_list_type) entity->m_type_handle = entity->m_list_type(entity);
+}
+
+
+void Entity::mark_removed(Entity* const entity)
+{
+    ENTER_FUNCTION(Entity::mark_removed);
+
+    if(entity->removable()) return;
+
+    Physics::flags[entity->m_physics_slot] |= Physics::Removed;
+    if(entities.contains(entity->m_handle))
+        removed.push_back(entity);
+}
+
+
+void Entity::update_activity(const World& world)
+{
+    ENTER_FUNCTION(Entity::update_activity);
+
+    ++activity_frame;
+    for(int i=0; i<ActivityTierCount; ++i)
+        activity_counts[i] = 0;
+
+    const float left = static_cast<float>(world.position().x());
+    const float top = static_cast<float>(world.position().y());
+    const float right = left + Video::window_width();
+    const float bottom = top + Video::window_height();
+
+    const float block_width = static_cast<float>(world.block_width());
+    const float block_height = static_cast<float>(world.block_height());
+
+    for(size_t i=0; i<entities.size(); ++i) {
+        Entity* const entity = entities[i];
+        if(entity->removable()) continue;
+
+        // how many blocks outside of the window the entity is
+        const int slot = entity->m_physics_slot;
+        const float x = Physics::position_x[slot], y = Physics::position_y[slot];
+        const float dx = std::max(0.0f, std::max(left - (x + std::max(0, entity->width())), x - right)) / block_width;
+        const float dy = std::max(0.0f, std::max(top - (y + std::max(0, entity->height())), y - bottom)) / block_height;
+        const float distance = std::max(dx, dy);
+
+        // entities only drop a tier once they're well past its edge
+        const ActivityTier tier = entity->m_activity;
+        if(distance <= active_blocks + (ActiveTier == tier ? hysteresis_blocks : 0))
+            entity->m_activity = ActiveTier;
+        else if(distance <= warm_blocks + (FrozenTier != tier ? hysteresis_blocks : 0))
+            entity->m_activity = WarmTier;
+        else entity->m_activity = FrozenTier;
+        ++activity_counts[entity->m_activity];
+
+        unsigned char& flags = Physics::flags[slot];
+        flags &= ~(Physics::Frozen | Physics::Deferred);
+        if(FrozenTier == entity->m_activity)
+            flags |= Physics::Frozen;
+        else if(WarmTier == entity->m_activity && ((activity_frame + entity->m_activity_phase) % warm_interval))
+            flags |= Physics::Deferred;
+
+        Animation::awake[entity->m_animation_slot] = (FrozenTier != entity->m_activity);
+    }
 }
 
 
@@ -160,10 +617,13 @@ bool Entity::collision(const Entity& a, const Entity& b)
 
 /* FIXME: should we snap the positions? */
 
-    if((a.position().x() <= b.position().x() && (a.position().x() + a.width()) >= b.position().x()) &&
-        (a.position().y() <= b.position().y() && (a.position().y() + a.height()) >= b.position().y()) ||
-        (a.position().x() >= b.position().x() && a.position().x() <= (b.position().x() + b.width())) &&
-        (a.position().y() >= b.position().y() && a.position().y() <= (b.position().y() + b.width())))
+    const Vector<float> ap(a.position());
+    const Vector<float> bp(b.position());
+
+    if((ap.x() <= bp.x() && (ap.x() + a.width()) >= bp.x()) &&
+        (ap.y() <= bp.y() && (ap.y() + a.height()) >= bp.y()) ||
+        (ap.x() >= bp.x() && ap.x() <= (bp.x() + b.width())) &&
+        (ap.y() >= bp.y() && ap.y() <= (bp.y() + b.height())))
         return true;
 
 /* FIXME: any more comparisons needed? */
@@ -178,21 +638,49 @@ bool Entity::collision(const Entity& a, const Entity& b)
  */
 
 
-Entity::Entity(bool add) : m_current_sprite_index(-1), m_animation_seconds(0.0f), m_mass(0.0f), m_removable(false)
+Entity::Entity(bool add)
+    : m_id(next_id++), m_list_type(NULL), m_release_type(NULL), m_archetype(NULL), m_animation_slot(-1), m_physics_slot(-1),
+        m_activity(ActiveTier), m_activity_phase(next_activity_phase++), m_draw_layer(0), m_drawn(false), m_collision_layer(PlayerLayer), m_collision_mask(0)
 {
     ENTER_FUNCTION(Entity::Entity);
 
+    // pooled classes have already checked in their operator new, this covers the rest
+    check_main_thread();
+
+    m_animation_slot = Animation::allocate(this);
+    m_physics_slot = Physics::allocate(this);
+
     if(add)
         push_back(this);
 }
 
 
+Entity::~Entity() throw()
+{
+    ENTER_FUNCTION(Entity::~Entity);
+
+    remove_from_draw_layer();
+    Physics::release(m_physics_slot);
+    Animation::release(m_animation_slot);
+}
+
+
 void Entity::load_media(const VideoState& video_state)
 {
     ENTER_FUNCTION(Entity::load_media);
 
     load_sprites(video_state);
     load_sounds();
+    enable_body();
+}
+
+
+void Entity::enable_body()
+{
+    ENTER_FUNCTION(Entity::enable_body);
+
+    if(width() >= 0 && height() >= 0)
+        Physics::flags[m_physics_slot] |= Physics::HasBody;
 }
 
 
@@ -200,55 +688,131 @@ std::bitset<World::CollisionSize> Entity::animate(float dt, const World& world)
 {
     ENTER_FUNCTION(Entity::animate);
 
+    if(width() >= 0 && height() >= 0)
+        Physics::integrate(m_physics_slot, dt);
+
+    const std::bitset<World::CollisionSize> wc = resolve(dt, world);
+    on_animate(dt, wc, world);
+    Animation::advance(m_animation_slot, dt);
+    return wc;
+}
+
+
+std::bitset<World::CollisionSize> Entity::resolve(float dt, const World& world)
+{
+    ENTER_FUNCTION(Entity::resolve);
+
     std::bitset<World::CollisionSize> wc;
-    if(width() < 0 || height() < 0) {
-        on_animate(dt, wc, world);
+    if(width() < 0 || height() < 0)
         return wc;
-    }
 
-    // gravity
-    m_acceleration.add_y(World::GRAVITY * m_mass);
+    const int i = m_physics_slot;
+    const Vector<float> old_position(position());
 
-    // s2 = s1 + (v1 * t) + ((a * t^2) / 2)
-    Vector<float> new_position = m_position + (m_velocity * dt) + ((m_acceleration * dt * dt) / 2);
-    wc = world.collision(m_position, &new_position, width(), height());
+    Vector<float> new_position(Physics::target_x[i], Physics::target_y[i], Physics::position_z[i]);
+    wc = world.collision(old_position, &new_position, width(), height());
 
     // respond to the world collisions
     if(wc[World::LeftCollision] || wc[World::RightCollision]) {
-        m_velocity.clear_x();
-        m_acceleration.clear_x();
+        Physics::velocity_x[i] = 0.0f;
+        Physics::acceleration_x[i] = 0.0f;
     }
     if(wc[World::BottomCollision] || wc[World::TopCollision]) {
-        m_velocity.clear_y();
-        m_acceleration.clear_y();
+        Physics::velocity_y[i] = 0.0f;
+        Physics::acceleration_y[i] = 0.0f;
 
         // friction
-        m_acceleration.add_x(m_velocity.x() != 0.0f ? m_velocity.x() > 1.0f ? -World::FRICTION * m_mass : World::FRICTION * m_mass : 0.0f);
+        const float vx = Physics::velocity_x[i];
+        Physics::acceleration_x[i] += (vx != 0.0f ? vx > 1.0f ? -World::FRICTION * Physics::mass[i] : World::FRICTION * Physics::mass[i] : 0.0f);
     } else {
         // v2 = v1 + (a * t)
-        m_velocity = m_velocity + (m_acceleration * dt);
+        Physics::velocity_x[i] = Physics::velocity_x[i] + (Physics::acceleration_x[i] * dt);
+        Physics::velocity_y[i] = Physics::velocity_y[i] + (Physics::acceleration_y[i] * dt);
     }
 
-    // check for entity-entity collisions
-    for(std::list<Entity*>::const_iterator it = entities.begin(); it != entities.end(); ++it) {
+    // check for entity-entity collisions, but only against what the broadphase turns up
+    broadphase.query(static_cast<int>(std::floor(old_position.x())), static_cast<int>(std::floor(old_position.y())),
+        static_cast<int>(std::ceil(old_position.x() + width())), static_cast<int>(std::ceil(old_position.y() + height())),
+        layer_bit(m_collision_layer), m_collision_mask, &candidates);
+    pairs_possible += entities.size();
+
+    const CollisionHandler* const handlers = collision_handlers[m_collision_layer];
+    for(std::vector<Entity*>::const_iterator it = candidates.begin(); it != candidates.end(); ++it) {
+        if(*it == this) continue;
+
+        // a pair without a handler registered for this layer against the other is dropped here, it only
+        // gets handled if the other layer registered one the other way round (when the other entity resolves)
+        const CollisionHandler handler = handlers[(*it)->m_collision_layer];
+        if(!handler) continue;
+
+        ++pairs_tested;
         if(collision(*this, *(*it))) {
-            on_collision(*it);
+            handler(this, *it);
         }
     }
-    m_position = new_position;
 
-    on_animate(dt, wc, world);
+    set_position(new_position);
     return wc;
 }
 
 
+void Entity::insert_broadphase()
+{
+    ENTER_FUNCTION(Entity::insert_broadphase);
+
+    if(width() < 0 || height() < 0) return;
+
+    // cover where we are and where integrate() is trying to put us this frame
+    const int i = m_physics_slot;
+    const float left = std::min(Physics::position_x[i], Physics::target_x[i]);
+    const float top = std::min(Physics::position_y[i], Physics::target_y[i]);
+    const float right = std::max(Physics::position_x[i], Physics::target_x[i]) + width();
+    const float bottom = std::max(Physics::position_y[i], Physics::target_y[i]) + height();
+
+    broadphase.insert(this, static_cast<int>(std::floor(left)), static_cast<int>(std::floor(top)),
+        static_cast<int>(std::ceil(right)), static_cast<int>(std::ceil(bottom)),
+        layer_bit(m_collision_layer), m_collision_mask);
+}
+
+
+void Entity::set_draw_layer(int layer)
+{
+    ENTER_FUNCTION(Entity::set_draw_layer);
+
+    if(m_drawn) {
+        remove_from_draw_layer();
+        draw_layers[layer].push_back(this);
+        m_drawn = true;
+    }
+    m_draw_layer = layer;
+}
+
+
+void Entity::remove_from_draw_layer()
+{
+    ENTER_FUNCTION(Entity::remove_from_draw_layer);
+
+    if(!m_drawn) return;
+
+    std::map<int, std::vector<Entity*> >::iterator layer = draw_layers.find(m_draw_layer);
+    if(layer != draw_layers.end()) {
+        std::vector<Entity*>::iterator it = std::find(layer->second.begin(), layer->second.end(), this);
+        if(it != layer->second.end()) layer->second.erase(it);
+
+        // empty layers are kept, so the next entity on the layer doesn't have to allocate it again
+    }
+    m_drawn = false;
+}
+
+
 void Entity::render(const World& world) const
 {
     ENTER_FUNCTION(Entity::render);
 
-    if(m_current_sprite_index < 0) return;
+    const int sprite_index = current_sprite();
+    if(sprite_index < 0) return;
 
-    Vector<int> pos = static_cast<Vector<int> >(m_position);
+    Vector<int> pos = static_cast<Vector<int> >(position());
 
     // only render if we're on-screen
     if((pos.y() + height()) < world.position().y() ||
@@ -261,7 +825,7 @@ void Entity::render(const World& world) const
     rect.x = pos.x() - world.position().x();
     rect.y = pos.y() - world.position().y();
 
-    Video::render_surface(m_current_sprite_index, NULL, &rect);
+    Video::render_surface(sprite_index, NULL, &rect);
 }
 
 
@@ -269,7 +833,8 @@ int Entity::width() const
 {
     ENTER_FUNCTION(Entity::width);
 
-    return (m_current_sprite_index >= 0) ? Video::at(m_current_sprite_index)->w : -1;
+    const int sprite_index = current_sprite();
+    return (sprite_index >= 0) ? Video::at(sprite_index)->w : -1;
 }
 
 
@@ -277,7 +842,18 @@ int Entity::height() const
 {
     ENTER_FUNCTION(Entity::height);
 
-    return (m_current_sprite_index >= 0) ? Video::at(m_current_sprite_index)->h : -1;
+    const int sprite_index = current_sprite();
+    return (sprite_index >= 0) ? Video::at(sprite_index)->h : -1;
+}
+
+
+void Entity::check_main_thread()
+{
+    // the slot stores aren't thread safe, and a race here corrupts every entity, so this can't wait for a debug build
+    if(WorkerPool::current_chunk() >= 0) {
+        std::cerr << "Entities can't be constructed on a worker thread" << std::endl;
+        abort();
+    }
 }
 
 
@@ -289,6 +865,33 @@ int Entity::load_sprite(const std::string& filename, int width, int height, cons
 }
 
 
+void Entity::use_archetype(const std::string& name, Archetype::Loader loader, const VideoState& video_state)
+{
+    ENTER_FUNCTION(Entity::use_archetype);
+
+    m_archetype = &Archetype::get(name, loader, video_state);
+}
+
+
+void Entity::set_removable()
+{
+    ENTER_FUNCTION(Entity::set_removable);
+
+    const int chunk = WorkerPool::current_chunk();
+    if(chunk >= 0) commands[chunk].push_back(Command(Command::Remove, this));
+    else mark_removed(this);
+}
+
+
+void Entity::play(const std::string& clip, bool mirrored)
+{
+    ENTER_FUNCTION(Entity::play);
+
+    if(m_archetype)
+        Animation::play(m_animation_slot, m_archetype->clip(clip, mirrored));
+}
+
+
 /*
  *  Entity friend functions
  *
@@ -297,14 +900,17 @@ int Entity::load_sprite(const std::string& filename, int width, int height, cons
 
 bool operator<(const Entity& lhs, const Entity& rhs)
 {
-    if(lhs.m_position.z() < rhs.m_position.z()) return true;
-    else if(rhs.m_position.z() < lhs.m_position.z()) return false;
+    const Vector<float> lp(lhs.position());
+    const Vector<float> rp(rhs.position());
+
+    if(lp.z() < rp.z()) return true;
+    else if(rp.z() < lp.z()) return false;
 
-    if(lhs.m_position.x() < rhs.m_position.x()) return true;
-    else if(rhs.m_position.x() < lhs.m_position.x()) return false;
+    if(lp.x() < rp.x()) return true;
+    else if(rp.x() < lp.x()) return false;
 
-    if(lhs.m_position.y() < rhs.m_position.y()) return true;
-    else if(rhs.m_position.y() < lhs.m_position.y()) return false;
+    if(lp.y() < rp.y()) return true;
+    else if(rp.y() < lp.y()) return false;
 
     return false;
 }
@@ -53,11 +53,16 @@ bool Font::load(const std::string& filename, const VideoState& video_state)
 }
 
 
-void Font::render_text(const std::string& text, SDL_Surface* const destination, int x, int y) const
+SDL_Rect Font::render_text(const std::string& text, SDL_Surface* const destination, int x, int y) const
 {
     ENTER_FUNCTION(Font::render_text);
 
-    if(!destination || m_surface_index < 0) return;
+    SDL_Rect area;
+    area.x = x; area.y = y;
+    area.w = area.h = 0;
+    if(!destination || m_surface_index < 0) return area;
+
+    int right = x, bottom = y;
 
     SDL_Rect pos;
     pos.x = x; pos.y = y;
@@ -94,5 +99,12 @@ void Font::render_text(const std::string& text, SDL_Surface* const destination,
 
         SDL_BlitSurface(Video::at(m_surface_index), &src, destination, &pos);
         pos.x += m_char_width;
+
+        right = std::max(right, static_cast<int>(pos.x));
+        bottom = std::max(bottom, pos.y + m_char_height);
     }
+
+    area.w = right - x;
+    area.h = bottom - y;
+    return area;
 }
@@ -0,0 +1,280 @@
+/**
+\file LevelFile.cc
+\author Shane Lillie
+\brief Compiled level source.
+
+\verbatim
+Copyright 2002-2003 Energon Software
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2, or (at your option)
+any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software Foundation,
+Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+\endverbatim
+*/
+
+
+
+#include "shared.h"
+#include "LevelFile.h"
+
+
+/*
+ *  LevelFile class functions
+ *
+ */
+
+
+LevelFile::LevelFile()
+    : m_chunk_bytes(0), m_collision(NULL), m_collision_row_bytes(0), m_tile_ids(NULL), m_tile_id_count(0), m_spawns(NULL), m_spawn_count(0),
+        m_width(0), m_height(0), m_chunk_size(0), m_chunk_shift(0), m_chunk_mask(0), m_chunks_wide(0), m_chunks_high(0),
+        m_thread(NULL), m_lock(NULL), m_work_ready(NULL), m_stopping(false)
+{
+    ENTER_FUNCTION(LevelFile::LevelFile);
+}
+
+
+LevelFile::~LevelFile() throw()
+{
+    ENTER_FUNCTION(LevelFile::~LevelFile);
+
+    close();
+}
+
+
+bool LevelFile::open(const std::string& filename)
+{
+    ENTER_FUNCTION(LevelFile::open);
+
+    close();
+
+    if(!m_file.open(filename)) return false;
+
+    const byte* const data = m_file.data();
+    const size_t size = m_file.size();
+
+    if(size < HeaderWords * 4 || read32(data) != Magic)
+        return invalid(filename, "header");
+    if(read32(data + 4) != Version) {
+        std::cerr << "Compiled level is version " << read32(data + 4) << ", not " << Version << ", recompile it - " << filename << std::endl;
+        close();
+        return false;
+    }
+
+    m_width = read32(data + 8);
+    m_height = read32(data + 12);
+    m_chunk_size = read32(data + 16);
+    m_chunks_wide = read32(data + 20);
+    m_chunks_high = read32(data + 24);
+
+    // tiles are found with shifts and masks
+    if(m_width <= 0 || m_height <= 0 || m_chunk_size <= 0 || (m_chunk_size & (m_chunk_size - 1))
+        || m_chunks_wide != (m_width + m_chunk_size - 1) / m_chunk_size
+        || m_chunks_high != (m_height + m_chunk_size - 1) / m_chunk_size)
+        return invalid(filename, "dimensions");
+
+    for(m_chunk_shift = 0; (1 << m_chunk_shift) < m_chunk_size; ++m_chunk_shift);
+    m_chunk_mask = m_chunk_size - 1;
+
+    m_chunk_bytes = m_chunk_size * m_chunk_size * 2;
+
+    const size_t count = m_chunks_wide * m_chunks_high;
+    if(size < (HeaderWords + count) * 4)
+        return invalid(filename, "index");
+
+    m_chunks.resize(count);
+    for(size_t i=0; i<count; ++i) {
+        const size_t offset = read32(data + ((HeaderWords + i) * 4));
+        if(offset > size || size - offset < static_cast<size_t>(m_chunk_bytes) || offset % ChunkAlignment)
+            return invalid(filename, "chunk");
+        m_chunks[i] = data + offset;
+    }
+
+    m_tile_id_count = read32(data + 28);
+    const size_t tile_ids = read32(data + 32);
+    if(tile_ids > size || (size - tile_ids) / 2 < static_cast<size_t>(m_tile_id_count))
+        return invalid(filename, "tile table");
+    m_tile_ids = data + tile_ids;
+
+    m_spawn_count = read32(data + 36);
+    const size_t spawns = read32(data + 40);
+    if(spawns > size || (size - spawns) / 12 < static_cast<size_t>(m_spawn_count))
+        return invalid(filename, "spawn table");
+    m_spawns = data + spawns;
+
+    m_collision_row_bytes = ((m_width + 63) >> 6) * 8;
+    const size_t collision = read32(data + 44);
+    if(collision > size || (size - collision) / m_collision_row_bytes < static_cast<size_t>(m_height) || collision % ChunkAlignment)
+        return invalid(filename, "collision plane");
+    m_collision = data + collision;
+
+    m_states.assign(count, Cold);
+
+    m_lock = SDL_CreateMutex();
+    m_work_ready = SDL_CreateCond();
+    if(m_lock && m_work_ready) {
+        m_stopping = false;
+        m_thread = SDL_CreateThread(work, this);
+    }
+    if(!m_thread) std::cerr << "Couldn't start the chunk loader, chunks will be paged in as they're used: " << SDL_GetError() << std::endl;
+
+    return true;
+}
+
+
+void LevelFile::close()
+{
+    ENTER_FUNCTION(LevelFile::close);
+
+    if(m_thread) {
+        SDL_LockMutex(m_lock);
+        m_stopping = true;
+        SDL_CondSignal(m_work_ready);
+        SDL_UnlockMutex(m_lock);
+
+        SDL_WaitThread(m_thread, NULL);
+        m_thread = NULL;
+    }
+
+    if(m_work_ready) SDL_DestroyCond(m_work_ready);
+    if(m_lock) SDL_DestroyMutex(m_lock);
+    m_work_ready = NULL;
+    m_lock = NULL;
+
+    m_requests.clear();
+    m_states.clear();
+    m_chunks.clear();
+
+    m_tile_ids = m_spawns = m_collision = NULL;
+    m_tile_id_count = m_spawn_count = 0;
+
+    m_file.close();
+
+    m_width = m_height = 0;
+    m_chunk_size = m_chunk_shift = m_chunk_mask = 0;
+    m_chunk_bytes = m_collision_row_bytes = 0;
+    m_chunks_wide = m_chunks_high = 0;
+}
+
+
+void LevelFile::request(int chunk)
+{
+    if(!m_thread || chunk < 0 || chunk >= static_cast<int>(m_states.size())) return;
+
+    SDL_LockMutex(m_lock);
+    if(Cold == m_states[chunk]) {
+        m_states[chunk] = Queued;
+        m_requests.push_back(chunk);
+        SDL_CondSignal(m_work_ready);
+    }
+    SDL_UnlockMutex(m_lock);
+}
+
+
+void LevelFile::release(int chunk)
+{
+    if(!m_thread || chunk < 0 || chunk >= static_cast<int>(m_states.size())) return;
+
+    SDL_LockMutex(m_lock);
+    const bool warm = (Warm == m_states[chunk]);
+    if(warm) m_states[chunk] = Cold;
+    SDL_UnlockMutex(m_lock);
+
+    if(!warm) return;
+
+    // the padding after the chunk is its own, so its last page goes too
+    const size_t padded = ((m_chunk_bytes + ChunkAlignment - 1) / ChunkAlignment) * ChunkAlignment;
+    m_file.discard(m_chunks[chunk], std::min(padded, static_cast<size_t>((m_file.data() + m_file.size()) - m_chunks[chunk])));
+}
+
+
+void LevelFile::cancel(std::vector<int>* const cancelled)
+{
+    if(!m_thread) return;
+
+    SDL_LockMutex(m_lock);
+    for(std::deque<int>::const_iterator it = m_requests.begin(); it != m_requests.end(); ++it)
+        m_states[*it] = Cold;
+    if(cancelled) cancelled->assign(m_requests.begin(), m_requests.end());
+    m_requests.clear();
+    SDL_UnlockMutex(m_lock);
+}
+
+
+bool LevelFile::ready(int chunk) const
+{
+    if(!m_thread) return true;
+    if(chunk < 0 || chunk >= static_cast<int>(m_states.size())) return false;
+
+    SDL_LockMutex(m_lock);
+    const bool warm = (Warm == m_states[chunk]);
+    SDL_UnlockMutex(m_lock);
+    return warm;
+}
+
+
+void LevelFile::discard_collision() const
+{
+    ENTER_FUNCTION(LevelFile::discard_collision);
+
+    if(m_collision) m_file.discard(m_collision, static_cast<size_t>(m_collision_row_bytes) * m_height);
+}
+
+
+void LevelFile::spawn(int index, char* const type, int* const x, int* const y) const
+{
+    const byte* const s = m_spawns + (index * 12);
+    *type = static_cast<char>(read32(s));
+    *x = read32(s + 4);
+    *y = read32(s + 8);
+}
+
+
+int LevelFile::work(void* data)
+{
+    LevelFile* const level = static_cast<LevelFile*>(data);
+    const int chunk_bytes = level->m_chunk_bytes;
+
+    // this only has to be read to make the system page it in
+    volatile byte sink = 0;
+
+    SDL_LockMutex(level->m_lock);
+    while(true) {
+        while(level->m_requests.empty() && !level->m_stopping)
+            SDL_CondWait(level->m_work_ready, level->m_lock);
+        if(level->m_stopping) break;
+
+        const int chunk = level->m_requests.front();
+        level->m_requests.pop_front();
+        SDL_UnlockMutex(level->m_lock);
+
+        const byte* const c = level->m_chunks[chunk];
+        for(int i=0; i<chunk_bytes; i+=1024)
+            sink = sink + c[i];
+        sink = sink + c[chunk_bytes - 1];
+
+        SDL_LockMutex(level->m_lock);
+        if(Queued == level->m_states[chunk]) level->m_states[chunk] = Warm;
+    }
+    SDL_UnlockMutex(level->m_lock);
+    return 0;
+}
+
+
+bool LevelFile::invalid(const std::string& filename, const char* const what)
+{
+    ENTER_FUNCTION(LevelFile::invalid);
+
+    std::cerr << "Invalid compiled level " << what << " - " << filename << std::endl;
+    close();
+    return false;
+}
@@ -0,0 +1,161 @@
+/**
+\file LevelPreloader.cc
+\author Shane Lillie
+\brief Background level loader source.
+
+\verbatim
+Copyright 2002-2003 Energon Software
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2, or (at your option)
+any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software Foundation,
+Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+\endverbatim
+*/
+
+
+#include "shared.h"
+#include "LevelPreloader.h"
+#include "World.h"
+
+
+/*
+ *  LevelPreloader class functions
+ *
+ */
+
+
+int LevelPreloader::work(void* data)
+{
+    LevelPreloader* const preloader = reinterpret_cast<LevelPreloader*>(data);
+
+    const bool ok = preloader->m_world->prepare(preloader->m_name, preloader->m_video_state, true);
+
+    SDL_LockMutex(preloader->m_lock);
+    preloader->m_ok = ok;
+    preloader->m_done = true;
+    SDL_UnlockMutex(preloader->m_lock);
+    return 0;
+}
+
+
+/*
+ *  LevelPreloader methods
+ *
+ */
+
+
+LevelPreloader::LevelPreloader()
+    : m_world(NULL), m_ok(false), m_done(false), m_thread(NULL), m_lock(NULL)
+{
+    ENTER_FUNCTION(LevelPreloader::LevelPreloader);
+}
+
+
+LevelPreloader::~LevelPreloader() throw()
+{
+    ENTER_FUNCTION(LevelPreloader::~LevelPreloader);
+
+    cancel();
+}
+
+
+bool LevelPreloader::start(const std::string& name, const VideoState& video_state)
+{
+    ENTER_FUNCTION(LevelPreloader::start);
+
+    if(!m_name.empty() && name == m_name
+        && video_state.width_scale == m_video_state.width_scale && video_state.height_scale == m_video_state.height_scale)
+        return true;
+
+    cancel();
+
+    m_name = name;
+    m_video_state = video_state;
+    m_world = new World();
+    m_ok = m_done = false;
+
+#if defined DEBUG
+    m_ok = m_world->prepare(m_name, m_video_state, true);
+    m_done = true;
+    return true;
+#else
+    m_lock = SDL_CreateMutex();
+    if(m_lock) m_thread = SDL_CreateThread(work, this);
+    if(!m_thread) {
+        std::cerr << "Couldn't start the level preloader: " << SDL_GetError() << std::endl;
+        cancel();
+        return false;
+    }
+    return true;
+#endif
+}
+
+
+bool LevelPreloader::ready() const
+{
+    ENTER_FUNCTION(LevelPreloader::ready);
+
+    if(!m_thread) return m_done;
+
+    SDL_LockMutex(m_lock);
+    const bool done = m_done;
+    SDL_UnlockMutex(m_lock);
+    return done;
+}
+
+
+World* LevelPreloader::take(const std::string& name)
+{
+    ENTER_FUNCTION(LevelPreloader::take);
+
+    if(m_name.empty() || name != m_name) return NULL;
+
+    wait();
+
+    World* world = m_world;
+    if(!m_ok) {
+        delete world;
+        world = NULL;
+    }
+
+    m_world = NULL;
+    m_name.clear();
+    m_ok = m_done = false;
+    return world;
+}
+
+
+void LevelPreloader::cancel()
+{
+    ENTER_FUNCTION(LevelPreloader::cancel);
+
+    wait();
+
+    if(m_world) delete m_world;
+    m_world = NULL;
+
+    m_name.clear();
+    m_ok = m_done = false;
+}
+
+
+void LevelPreloader::wait()
+{
+    ENTER_FUNCTION(LevelPreloader::wait);
+
+    if(m_thread) SDL_WaitThread(m_thread, NULL);
+    m_thread = NULL;
+
+    if(m_lock) SDL_DestroyMutex(m_lock);
+    m_lock = NULL;
+}
@@ -0,0 +1,145 @@
+/**
+\file MappedFile.cc
+\author Shane Lillie
+\brief Read only memory mapped file source.
+
+\verbatim
+Copyright 2002-2003 Energon Software
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2, or (at your option)
+any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software Foundation,
+Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+\endverbatim
+*/
+
+
+
+#include "shared.h"
+
+#if defined WIN32
+    #include <windows.h>
+#else
+    #include <sys/mman.h>
+    #include <fcntl.h>
+#endif
+
+#include "MappedFile.h"
+
+
+/*
+ *  MappedFile class functions
+ *
+ */
+
+
+MappedFile::MappedFile()
+    : m_data(NULL), m_size(0)
+#if defined WIN32
+        , m_file(INVALID_HANDLE_VALUE), m_mapping(NULL)
+#endif
+{
+    ENTER_FUNCTION(MappedFile::MappedFile);
+}
+
+
+MappedFile::~MappedFile() throw()
+{
+    ENTER_FUNCTION(MappedFile::~MappedFile);
+
+    close();
+}
+
+
+bool MappedFile::open(const std::string& filename)
+{
+    ENTER_FUNCTION(MappedFile::open);
+
+    close();
+
+#if defined WIN32
+    m_file = CreateFile(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if(INVALID_HANDLE_VALUE == m_file) return false;
+
+    m_size = GetFileSize(m_file, NULL);
+    if(m_size) m_mapping = CreateFileMapping(m_file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if(m_mapping) m_data = static_cast<const byte*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+#else
+    const int fd = ::open(filename.c_str(), O_RDONLY);
+    if(fd < 0) return false;
+
+    struct stat buf;
+    if(!fstat(fd, &buf) && buf.st_size > 0) {
+        m_size = buf.st_size;
+        void* const data = mmap(NULL, m_size, PROT_READ, MAP_SHARED, fd, 0);
+        if(MAP_FAILED != data) m_data = static_cast<const byte*>(data);
+    }
+
+    // the mapping keeps its own reference to the file
+    ::close(fd);
+#endif
+
+    if(!m_data) {
+        std::cerr << "Couldn't map " << filename << std::endl;
+        close();
+        return false;
+    }
+    return true;
+}
+
+
+void MappedFile::close()
+{
+    ENTER_FUNCTION(MappedFile::close);
+
+#if defined WIN32
+    if(m_data) UnmapViewOfFile(m_data);
+    if(m_mapping) CloseHandle(m_mapping);
+    if(INVALID_HANDLE_VALUE != m_file) CloseHandle(m_file);
+    m_file = INVALID_HANDLE_VALUE;
+    m_mapping = NULL;
+#else
+    if(m_data) munmap(const_cast<byte*>(m_data), m_size);
+#endif
+
+    m_data = NULL;
+    m_size = 0;
+}
+
+
+void MappedFile::discard(const byte* const start, size_t length) const
+{
+    ENTER_FUNCTION(MappedFile::discard);
+
+    if(!m_data || start < m_data || start + length > m_data + m_size) return;
+
+#if defined WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    const size_t page = info.dwPageSize;
+#else
+    const size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+#endif
+
+    // round in to whole pages
+    const size_t first = ((reinterpret_cast<size_t>(start) + page - 1) / page) * page;
+    const size_t last = ((reinterpret_cast<size_t>(start) + length) / page) * page;
+    if(first >= last) return;
+
+#if defined WIN32
+    // unlocking pages that aren't locked takes them out of the working set, which is as close as a file view gets
+    VirtualUnlock(reinterpret_cast<void*>(first), last - first);
+#else
+    // the pages are clean, so they're just dropped and read back from the file if they're touched again
+    madvise(reinterpret_cast<void*>(first), last - first, MADV_DONTNEED);
+#endif
+}
@@ -0,0 +1,482 @@
+/**
+\file NavGraph.cc
+\author Shane Lillie
+\brief Platformer navigation graph source.
+
+\verbatim
+Copyright 2002-2003 Energon Software
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2, or (at your option)
+any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software Foundation,
+Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+\endverbatim
+*/
+
+
+#include <functional>
+
+#include "shared.h"
+
+#if defined WIN32
+    #include <process.h>
+    #define getpid _getpid
+#endif
+
+#include "NavGraph.h"
+#include "CollisionGrid.h"
+
+
+/*
+ *  functions
+ *
+ */
+
+
+/* fractional header values are saved in 1/16ths */
+inline unsigned int fixed(float value)
+{
+    return static_cast<unsigned int>(static_cast<int>(value * 16.0f));
+}
+
+
+inline unsigned int read32(const byte* const data)
+{
+    return data[0] | (data[1] << 8) | (data[2] << 16) | (static_cast<unsigned int>(data[3]) << 24);
+}
+
+
+inline void write32(std::ostream& out, unsigned int word)
+{
+    out.put(static_cast<char>(word & 0xff));
+    out.put(static_cast<char>((word >> 8) & 0xff));
+    out.put(static_cast<char>((word >> 16) & 0xff));
+    out.put(static_cast<char>((word >> 24) & 0xff));
+}
+
+
+/* whether nothing in [x0, x1] x [y0, y1] is collidable (outside of the map is clear) */
+inline bool open_area(const CollisionGrid& collision, int x0, int y0, int x1, int y1)
+{
+    return !collision.any(x0, y0, x1, y1);
+}
+
+
+/*
+ *  NavGraph methods
+ *
+ */
+
+
+NavGraph::NavGraph()
+    : m_width(0), m_height(0), m_block_width(1), m_block_height(1)
+{
+}
+
+
+void NavGraph::build(const CollisionGrid& collision, int block_width, int block_height, const Mover& mover, float gravity)
+{
+    ENTER_FUNCTION(NavGraph::build);
+
+    clear();
+
+    m_width = collision.width();
+    m_height = collision.height();
+    m_block_width = std::max(1, block_width);
+    m_block_height = std::max(1, block_height);
+    stamp(&m_stamp, collision, m_block_width, m_block_height, mover, gravity);
+
+    const int mover_width = std::max(1, (mover.width + m_block_width - 1) / m_block_width);
+    const int mover_height = std::max(1, (mover.height + m_block_height - 1) / m_block_height);
+
+    add_segments(collision, mover_width, mover_height);
+    for(int i=0; i<segment_count(); ++i) {
+        m_segments[i].first_edge = edge_count();
+
+        add_drop(i, m_segments[i].x0 - 1, collision, mover_width, mover_height);
+        add_drop(i, m_segments[i].x1 + 1, collision, mover_width, mover_height);
+        if(gravity > 0.0f && mover.jump_velocity > 0.0f)
+            add_jumps(i, collision, mover_width, mover_height, mover, gravity);
+
+        m_segments[i].edge_count = edge_count() - m_segments[i].first_edge;
+    }
+}
+
+
+bool NavGraph::load(const std::string& filename, const CollisionGrid& collision, int block_width, int block_height, const Mover& mover, float gravity)
+{
+    ENTER_FUNCTION(NavGraph::load);
+
+    clear();
+
+    std::ifstream infile(filename.c_str(), std::ios::in | std::ios::binary);
+    if(!infile) return false;
+
+    std::vector<byte> data;
+    char c;
+    while(infile.get(c)) data.push_back(static_cast<byte>(c));
+    infile.close();
+
+    std::vector<unsigned int> header;
+    stamp(&header, collision, std::max(1, block_width), std::max(1, block_height), mover, gravity);
+
+    // everything in the stamp has to match, or the graph was built for something else
+    const size_t header_bytes = (header.size() + 2) * 4;
+    if(data.size() < header_bytes) return false;
+    for(size_t i=0; i<header.size(); ++i)
+        if(read32(&data[i * 4]) != header[i]) return false;
+
+    // the counts come out of the file too, so they're checked against its size before they're multiplied out
+    const int segments = static_cast<int>(read32(&data[header_bytes - 8]));
+    const int edges = static_cast<int>(read32(&data[header_bytes - 4]));
+    const size_t records = (data.size() - header_bytes) / 20;
+    if(segments < 0 || edges < 0 || (data.size() - header_bytes) % 20
+        || static_cast<size_t>(segments) > records || static_cast<size_t>(edges) != records - segments)
+        return false;
+
+    m_width = collision.width();
+    m_height = collision.height();
+    m_block_width = std::max(1, block_width);
+    m_block_height = std::max(1, block_height);
+    m_stamp = header;
+
+    // a broken cache gets thrown out here, since find_path() and segment_at() index with all of this
+    const byte* p = &data[header_bytes];
+    m_segments.resize(segments);
+    for(int i=0; i<segments; ++i, p += 20) {
+        Segment& segment = m_segments[i];
+        segment.y = read32(p);
+        segment.x0 = read32(p + 4);
+        segment.x1 = read32(p + 8);
+        segment.first_edge = read32(p + 12);
+        segment.edge_count = read32(p + 16);
+
+        // segment_at() counts on them being in order, by row and then left to right
+        const bool ordered = !i || segment.y > m_segments[i - 1].y || (segment.y == m_segments[i - 1].y && segment.x0 > m_segments[i - 1].x1);
+        if(segment.y < 0 || segment.y >= m_height || segment.x0 < 0 || segment.x0 > segment.x1 || segment.x1 >= m_width
+            || segment.first_edge < 0 || segment.edge_count < 0 || segment.first_edge > edges - segment.edge_count || !ordered) {
+            clear();
+            return false;
+        }
+    }
+
+    m_edges.resize(edges);
+    for(int i=0; i<edges; ++i, p += 20) {
+        Edge& edge = m_edges[i];
+        const int type = static_cast<int>(read32(p + 4));
+        edge.to = read32(p);
+        edge.type = static_cast<EdgeType>(type);
+        edge.from_x = read32(p + 8);
+        edge.to_x = read32(p + 12);
+        edge.cost = static_cast<int>(read32(p + 16)) / 16.0f;
+        if(edge.to < 0 || edge.to >= segments || (type != DropEdge && type != JumpEdge)
+            || edge.from_x < 0 || edge.from_x >= m_width || edge.to_x < 0 || edge.to_x >= m_width || edge.cost < 0.0f) {
+            clear();
+            return false;
+        }
+    }
+
+    m_rows.assign(m_height + 1, segments);
+    for(int i=segments-1; i>=0; --i)
+        m_rows[m_segments[i].y] = i;
+    for(int y=m_height-1; y>=0; --y)
+        m_rows[y] = std::min(m_rows[y], m_rows[y + 1]);
+    return true;
+}
+
+
+bool NavGraph::save(const std::string& filename) const
+{
+    ENTER_FUNCTION(NavGraph::save);
+
+    // another game could be loading the same level, so it only ever sees a whole graph
+    std::ostringstream temp;
+    temp << filename << "." << getpid() << ".tmp";
+
+    std::ofstream outfile(temp.str().c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+    if(!outfile) return false;
+
+    for(std::vector<unsigned int>::const_iterator it = m_stamp.begin(); it != m_stamp.end(); ++it)
+        write32(outfile, *it);
+
+    write32(outfile, segment_count());
+    write32(outfile, edge_count());
+    for(std::vector<Segment>::const_iterator it = m_segments.begin(); it != m_segments.end(); ++it) {
+        write32(outfile, it->y);
+        write32(outfile, it->x0);
+        write32(outfile, it->x1);
+        write32(outfile, it->first_edge);
+        write32(outfile, it->edge_count);
+    }
+    for(std::vector<Edge>::const_iterator it = m_edges.begin(); it != m_edges.end(); ++it) {
+        write32(outfile, it->to);
+        write32(outfile, it->type);
+        write32(outfile, it->from_x);
+        write32(outfile, it->to_x);
+        write32(outfile, fixed(it->cost));
+    }
+
+    outfile.close();
+    if(outfile.fail()) {
+        std::remove(temp.str().c_str());
+        return false;
+    }
+
+#if defined WIN32
+    // rename() won't replace a file here
+    std::remove(filename.c_str());
+#endif
+    if(std::rename(temp.str().c_str(), filename.c_str())) {
+        std::remove(temp.str().c_str());
+        return false;
+    }
+    return true;
+}
+
+
+void NavGraph::clear()
+{
+    ENTER_FUNCTION(NavGraph::clear);
+
+    m_width = m_height = 0;
+    m_stamp.clear();
+    m_segments.clear();
+    m_rows.clear();
+    m_edges.clear();
+}
+
+
+int NavGraph::segment_at(int x, int y) const
+{
+    ENTER_FUNCTION(NavGraph::segment_at);
+
+    if(y < 0 || y >= m_height || m_rows.empty()) return -1;
+
+    // there's only ever a few segments on a row
+    for(int i=m_rows[y]; i<m_rows[y + 1]; ++i) {
+        if(x < m_segments[i].x0) break;
+        if(x <= m_segments[i].x1) return i;
+    }
+    return -1;
+}
+
+
+bool NavGraph::find_path(int from, int from_x, int to, int to_x, Search* const search, std::vector<int>* const path) const
+{
+    ENTER_FUNCTION(NavGraph::find_path);
+
+    path->clear();
+    if(from < 0 || to < 0 || from >= segment_count() || to >= segment_count()) return false;
+    if(from == to) return true;
+
+    // the scratch space only grows the first time it's used with this graph
+    const size_t count = m_segments.size();
+    if(search->cost.size() != count) {
+        search->cost.assign(count, 0.0f);
+        search->entry_x.assign(count, 0);
+        search->via.assign(count, -1);
+        search->parent.assign(count, -1);
+        search->mark.assign(count, 0);
+        search->closed.assign(count, 0);
+        search->open.reserve(count);
+        search->generation = 0;
+    }
+    if(0 == ++search->generation) {
+        std::fill(search->mark.begin(), search->mark.end(), 0);
+        std::fill(search->closed.begin(), search->closed.end(), 0);
+        search->generation = 1;
+    }
+    const unsigned int generation = search->generation;
+
+    const float block_width = static_cast<float>(m_block_width);
+    const float block_height = static_cast<float>(m_block_height);
+    const int to_y = m_segments[to].y;
+
+    std::vector<std::pair<float, int> >& open = search->open;
+    const std::greater<std::pair<float, int> > later;
+    open.clear();
+
+    search->cost[from] = 0.0f;
+    search->entry_x[from] = from_x;
+    search->via[from] = -1;
+    search->parent[from] = -1;
+    search->mark[from] = generation;
+    open.push_back(std::make_pair(0.0f, from));
+
+    while(!open.empty()) {
+        std::pop_heap(open.begin(), open.end(), later);
+        const int node = open.back().second;
+        open.pop_back();
+
+        if(search->closed[node] == generation) continue;
+        search->closed[node] = generation;
+
+        if(node == to) {
+            for(int n=to; search->via[n] >= 0; n=search->parent[n])
+                path->push_back(search->via[n]);
+            std::reverse(path->begin(), path->end());
+            return true;
+        }
+
+        const Segment& segment = m_segments[node];
+        for(int i=segment.first_edge; i<segment.first_edge + segment.edge_count; ++i) {
+            const Edge& edge = m_edges[i];
+            if(search->closed[edge.to] == generation) continue;
+
+            // walking to where the edge leaves is part of taking it
+            const float cost = search->cost[node] + (std::abs(search->entry_x[node] - edge.from_x) * block_width) + edge.cost;
+            if(search->mark[edge.to] == generation && cost >= search->cost[edge.to]) continue;
+
+            search->cost[edge.to] = cost;
+            search->entry_x[edge.to] = edge.to_x;
+            search->via[edge.to] = i;
+            search->parent[edge.to] = node;
+            search->mark[edge.to] = generation;
+
+            const float estimate = (std::abs(edge.to_x - to_x) * block_width) + (std::abs(m_segments[edge.to].y - to_y) * block_height);
+            open.push_back(std::make_pair(cost + estimate, edge.to));
+            std::push_heap(open.begin(), open.end(), later);
+        }
+    }
+    return false;
+}
+
+
+void NavGraph::add_segments(const CollisionGrid& collision, int mover_width, int mover_height)
+{
+    ENTER_FUNCTION(NavGraph::add_segments);
+
+    m_rows.assign(m_height + 1, 0);
+    for(int y=0; y<m_height; ++y) {
+        m_rows[y] = segment_count();
+
+        // the bottom row has nothing under it to stand on
+        if(y + 1 >= m_height) continue;
+
+        int start = -1;
+        for(int x=0; x<=m_width; ++x) {
+            const bool standable = x <= m_width - mover_width && collision.test(x, y + 1)
+                && open_area(collision, x, y - mover_height + 1, x + mover_width - 1, y);
+            if(standable && start < 0) start = x;
+            else if(!standable && start >= 0) {
+                Segment segment;
+                segment.y = y;
+                segment.x0 = start;
+                segment.x1 = x - 1;
+                segment.first_edge = segment.edge_count = 0;
+                m_segments.push_back(segment);
+                start = -1;
+            }
+        }
+    }
+    m_rows[m_height] = segment_count();
+}
+
+
+void NavGraph::add_drop(int segment, int x, const CollisionGrid& collision, int mover_width, int mover_height)
+{
+    ENTER_FUNCTION(NavGraph::add_drop);
+
+    const int y = m_segments[segment].y;
+    if(x < 0 || x > m_width - mover_width) return;
+
+    // there has to be room to step off
+    if(!open_area(collision, x, y - mover_height + 1, x + mover_width - 1, y)) return;
+
+    int landing = y;
+    while(landing + 1 < m_height && open_area(collision, x, landing + 1, x + mover_width - 1, landing + 1))
+        ++landing;
+    if(landing + 1 >= m_height) return;     /* off the bottom of the world */
+
+    const int to = segment_at(x, landing);
+    if(to < 0 || to == segment) return;
+
+    Edge edge;
+    edge.to = to;
+    edge.type = DropEdge;
+    edge.from_x = (x < m_segments[segment].x0) ? m_segments[segment].x0 : m_segments[segment].x1;
+    edge.to_x = x;
+    edge.cost = static_cast<float>(m_block_width + ((landing - y) * m_block_height));
+    m_edges.push_back(edge);
+}
+
+
+void NavGraph::add_jumps(int segment, const CollisionGrid& collision, int mover_width, int mover_height, const Mover& mover, float gravity)
+{
+    ENTER_FUNCTION(NavGraph::add_jumps);
+
+    const Segment from = m_segments[segment];
+
+    // the mover has to get a block above the higher of the two segments to clear its edge
+    const float apex = (mover.jump_velocity * mover.jump_velocity) / (2.0f * gravity);
+    const int rows = static_cast<int>(apex / m_block_height) - 1;
+    if(rows < 0) return;
+
+    for(int y=std::max(0, from.y - rows); y<=std::min(m_height - 1, from.y + rows); ++y) {
+        // how far the mover gets sideways before it comes back down to this row
+        const float rise = static_cast<float>((from.y - y) * m_block_height);
+        const float time = (mover.jump_velocity + std::sqrt((mover.jump_velocity * mover.jump_velocity) - (2.0f * gravity * rise))) / gravity;
+        const int reach = static_cast<int>((mover.max_speed * time) / m_block_width);
+        if(reach < 1) continue;
+
+        const int top = std::min(from.y, y) - mover_height;
+        for(int i=m_rows[y]; i<m_rows[y + 1]; ++i) {
+            if(i == segment) continue;
+            const Segment& to = m_segments[i];
+
+            // jumps leave from the end of the segment they go past
+            int from_x, to_x;
+            if(to.x1 < from.x0) {
+                from_x = from.x0;
+                to_x = to.x1;
+            } else if(to.x0 > from.x1) {
+                from_x = from.x1;
+                to_x = to.x0;
+            } else continue;
+            if(std::abs(to_x - from_x) > reach) continue;
+
+            // up from the takeoff, across above both segments, and down onto the landing
+            const int left = std::min(from_x, to_x), right = std::max(from_x, to_x) + mover_width - 1;
+            if(!open_area(collision, from_x, top, from_x + mover_width - 1, from.y)) continue;
+            if(!open_area(collision, left, top, right, std::min(from.y, y) - 1)) continue;
+            if(!open_area(collision, to_x, top, to_x + mover_width - 1, y)) continue;
+
+            Edge edge;
+            edge.to = i;
+            edge.type = JumpEdge;
+            edge.from_x = from_x;
+            edge.to_x = to_x;
+            edge.cost = (std::abs(to_x - from_x) * m_block_width) + std::fabs(rise) + m_block_height;
+            m_edges.push_back(edge);
+        }
+    }
+}
+
+
+void NavGraph::stamp(std::vector<unsigned int>* const words, const CollisionGrid& collision, int block_width, int block_height, const Mover& mover, float gravity) const
+{
+    ENTER_FUNCTION(NavGraph::stamp);
+
+    words->clear();
+    words->push_back(Magic);
+    words->push_back(Version);
+    words->push_back(collision.width());
+    words->push_back(collision.height());
+    words->push_back(collision.hash());
+    words->push_back(block_width);
+    words->push_back(block_height);
+    words->push_back(mover.width);
+    words->push_back(mover.height);
+    words->push_back(fixed(mover.max_speed));
+    words->push_back(fixed(mover.jump_velocity));
+    words->push_back(fixed(gravity));
+}
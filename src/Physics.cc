@@ -0,0 +1,197 @@
+/**
+\file Physics.cc
+\author Shane Lillie
+\brief Entity physics state source.
+
+\verbatim
+Copyright 2002-2003 Energon Software
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2, or (at your option)
+any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software Foundation,
+Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+\endverbatim
+*/
+
+
+#include "shared.h"
+#include "Physics.h"
+#include "Entity.h"
+#include "World.h"
+
+
+/*
+ *  Physics class variables
+ *
+ */
+
+
+std::vector<float> Physics::position_x;
+std::vector<float> Physics::position_y;
+std::vector<float> Physics::position_z;
+std::vector<float> Physics::velocity_x;
+std::vector<float> Physics::velocity_y;
+std::vector<float> Physics::acceleration_x;
+std::vector<float> Physics::acceleration_y;
+std::vector<float> Physics::mass;
+
+std::vector<float> Physics::target_x;
+std::vector<float> Physics::target_y;
+std::vector<float> Physics::elapsed;
+
+std::vector<unsigned char> Physics::flags;
+std::vector<Entity*> Physics::owner;
+
+
+/*
+ *  Physics class functions
+ *
+ */
+
+
+int Physics::allocate(Entity* const entity)
+{
+    ENTER_FUNCTION(Physics::allocate);
+
+    position_x.push_back(0.0f);
+    position_y.push_back(0.0f);
+    position_z.push_back(0.0f);
+    velocity_x.push_back(0.0f);
+    velocity_y.push_back(0.0f);
+    acceleration_x.push_back(0.0f);
+    acceleration_y.push_back(0.0f);
+    mass.push_back(0.0f);
+
+    target_x.push_back(0.0f);
+    target_y.push_back(0.0f);
+    elapsed.push_back(0.0f);
+
+    flags.push_back(0);
+    owner.push_back(entity);
+
+    return size() - 1;
+}
+
+
+void Physics::reserve(int count)
+{
+    ENTER_FUNCTION(Physics::reserve);
+
+    if(count <= 0) return;
+
+    position_x.reserve(count);
+    position_y.reserve(count);
+    position_z.reserve(count);
+    velocity_x.reserve(count);
+    velocity_y.reserve(count);
+    acceleration_x.reserve(count);
+    acceleration_y.reserve(count);
+    mass.reserve(count);
+
+    target_x.reserve(count);
+    target_y.reserve(count);
+    elapsed.reserve(count);
+
+    flags.reserve(count);
+    owner.reserve(count);
+}
+
+
+void Physics::release(int slot)
+{
+    ENTER_FUNCTION(Physics::release);
+
+    if(slot < 0 || slot >= size()) return;
+
+    const int last = size() - 1;
+    if(slot != last) {
+        position_x[slot] = position_x[last];
+        position_y[slot] = position_y[last];
+        position_z[slot] = position_z[last];
+        velocity_x[slot] = velocity_x[last];
+        velocity_y[slot] = velocity_y[last];
+        acceleration_x[slot] = acceleration_x[last];
+        acceleration_y[slot] = acceleration_y[last];
+        mass[slot] = mass[last];
+
+        target_x[slot] = target_x[last];
+        target_y[slot] = target_y[last];
+        elapsed[slot] = elapsed[last];
+
+        flags[slot] = flags[last];
+        owner[slot] = owner[last];
+        owner[slot]->m_physics_slot = slot;
+    }
+
+    position_x.pop_back();
+    position_y.pop_back();
+    position_z.pop_back();
+    velocity_x.pop_back();
+    velocity_y.pop_back();
+    acceleration_x.pop_back();
+    acceleration_y.pop_back();
+    mass.pop_back();
+
+    target_x.pop_back();
+    target_y.pop_back();
+    elapsed.pop_back();
+
+    flags.pop_back();
+    owner.pop_back();
+}
+
+
+void Physics::integrate(float dt)
+{
+    ENTER_FUNCTION(Physics::integrate);
+
+    integrate(dt, 0, size());
+}
+
+
+void Physics::integrate(float dt, int begin, int end)
+{
+    ENTER_FUNCTION(Physics::integrate);
+
+    for(int i=begin; i<end; ++i) {
+        if((flags[i] & (Listed | Removed | Frozen)) != Listed) continue;
+
+        // warm slots save up their time until they're stepped
+        elapsed[i] += dt;
+        if(!(flags[i] & HasBody)) continue;
+
+        if(flags[i] & Deferred) {
+            target_x[i] = position_x[i];
+            target_y[i] = position_y[i];
+            continue;
+        }
+
+        // gravity
+        acceleration_y[i] += World::GRAVITY * mass[i];
+
+        // s2 = s1 + (v1 * t) + ((a * t^2) / 2)
+        const float t = elapsed[i];
+        target_x[i] = position_x[i] + (velocity_x[i] * t) + ((acceleration_x[i] * t * t) / 2);
+        target_y[i] = position_y[i] + (velocity_y[i] * t) + ((acceleration_y[i] * t * t) / 2);
+    }
+}
+
+
+void Physics::integrate(int slot, float dt)
+{
+    ENTER_FUNCTION(Physics::integrate);
+
+    acceleration_y[slot] += World::GRAVITY * mass[slot];
+
+    target_x[slot] = position_x[slot] + (velocity_x[slot] * dt) + ((acceleration_x[slot] * dt * dt) / 2);
+    target_y[slot] = position_y[slot] + (velocity_y[slot] * dt) + ((acceleration_y[slot] * dt * dt) / 2);
+}
@@ -0,0 +1,83 @@
+/**
+\file Pool.cc
+\author Shane Lillie
+\brief Fixed-size object pool source.
+
+\verbatim
+Copyright 2002-2003 Energon Software
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2, or (at your option)
+any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software Foundation,
+Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+\endverbatim
+*/
+
+
+#include "shared.h"
+#include "Pool.h"
+
+
+/*
+ *  PoolBase class functions
+ *
+ */
+
+
+void PoolBase::print_pools(std::ostream& out)
+{
+    ENTER_FUNCTION(PoolBase::print_pools);
+
+    out << "I have " << pools().size() << " pools" << std::endl;
+    for(std::vector<PoolBase*>::const_iterator it = pools().begin(); it != pools().end(); ++it) {
+        out << (*it)->m_name << ": " << (*it)->size() << " in use, "
+            << (*it)->high_water_mark() << " high-water, "
+            << (*it)->capacity() << " capacity" << std::endl;
+    }
+}
+
+
+void PoolBase::reset_high_water_marks()
+{
+    ENTER_FUNCTION(PoolBase::reset_high_water_marks);
+
+    for(std::vector<PoolBase*>::iterator it = pools().begin(); it != pools().end(); ++it)
+        (*it)->m_high_water_mark = (*it)->m_size;
+}
+
+
+/* pools are usually static members, so this dodges the initialization order */
+std::vector<PoolBase*>& PoolBase::pools()
+{
+    static std::vector<PoolBase*> pool_vector;
+    return pool_vector;
+}
+
+
+/*
+ *  PoolBase methods
+ *
+ */
+
+
+PoolBase::PoolBase(const std::string& name)
+    : m_name(name), m_size(0), m_capacity(0), m_high_water_mark(0)
+{
+    pools().push_back(this);
+}
+
+
+PoolBase::~PoolBase() throw()
+{
+    std::vector<PoolBase*>::iterator it = std::find(pools().begin(), pools().end(), this);
+    if(it != pools().end()) pools().erase(it);
+}
@@ -0,0 +1,282 @@
+/**
+\file Rewind.cc
+\author Shane Lillie
+\brief Rewind buffer source.
+
+\verbatim
+Copyright 2002-2003 Energon Software
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2, or (at your option)
+any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software Foundation,
+Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+\endverbatim
+*/
+
+
+
+#include "shared.h"
+#include "Rewind.h"
+
+
+/*
+ *  Rewind constants
+ *
+ */
+
+
+// changed runs carry on through unchanged stretches shorter than this,
+// since starting a new run costs more than the bytes it would skip
+const size_t MIN_SAME_RUN = 4;
+
+const size_t MAX_RUN = 0xffff;
+
+
+/*
+ *  Rewind functions
+ *
+ */
+
+
+inline unsigned char key_byte(const std::vector<unsigned char>& key, size_t i)
+{
+    return i < key.size() ? key[i] : 0;
+}
+
+
+inline void put16(std::vector<unsigned char>* const out, size_t value)
+{
+    out->push_back(static_cast<unsigned char>(value & 0xff));
+    out->push_back(static_cast<unsigned char>((value >> 8) & 0xff));
+}
+
+
+inline size_t get16(const std::vector<unsigned char>& in, size_t pos)
+{
+    return in[pos] | (in[pos + 1] << 8);
+}
+
+
+inline void put32(std::vector<unsigned char>* const out, size_t value)
+{
+    put16(out, value & 0xffff);
+    put16(out, (value >> 16) & 0xffff);
+}
+
+
+inline size_t get32(const std::vector<unsigned char>& in, size_t pos)
+{
+    return get16(in, pos) | (get16(in, pos + 2) << 16);
+}
+
+
+/*
+ *  Rewind class functions
+ *
+ */
+
+
+Rewind::Rewind()
+    : m_first(0), m_count(0), m_keyframe_interval(1), m_since_keyframe(0)
+{
+    ENTER_FUNCTION(Rewind::Rewind);
+}
+
+
+void Rewind::reset(int frames, int keyframe_interval)
+{
+    ENTER_FUNCTION(Rewind::reset);
+
+    m_frames.clear();
+    m_frames.resize(std::max(1, frames));
+    m_first = m_count = 0;
+
+    m_keyframe_interval = std::max(1, keyframe_interval);
+    m_since_keyframe = 0;
+}
+
+
+void Rewind::push(const std::vector<unsigned char>& frame)
+{
+    ENTER_FUNCTION(Rewind::push);
+
+    if(m_frames.empty()) return;
+
+    if(m_count == static_cast<int>(m_frames.size()))
+        drop_oldest();
+
+    // at(0) is still the newest frame here, so the keyframe is m_since_keyframe-1 back
+    const bool key = !m_count || m_since_keyframe >= m_keyframe_interval;
+    Frame& f = m_frames[(m_first + m_count) % m_frames.size()];
+    if(key) {
+        f.data = frame;
+        m_since_keyframe = 1;
+    } else {
+        encode(frame, at(m_since_keyframe - 1).data, &f.data);
+        ++m_since_keyframe;
+    }
+    f.key = key;
+    ++m_count;
+}
+
+
+bool Rewind::frame(int back, std::vector<unsigned char>* const frame) const
+{
+    ENTER_FUNCTION(Rewind::frame);
+
+    if(back < 0 || back >= m_count) return false;
+
+    const Frame& f = at(back);
+    if(f.key) {
+        *frame = f.data;
+        return true;
+    }
+
+    // the oldest frame is always a keyframe, so this stops within one interval
+    int key = back + 1;
+    while(!at(key).key) ++key;
+
+    decode(f.data, at(key).data, frame);
+    return true;
+}
+
+
+void Rewind::drop(int count)
+{
+    ENTER_FUNCTION(Rewind::drop);
+
+    m_count = std::max(0, m_count - count);
+
+    m_since_keyframe = 0;
+    while(m_since_keyframe < m_count && !at(m_since_keyframe).key)
+        ++m_since_keyframe;
+    if(m_since_keyframe < m_count) ++m_since_keyframe;
+}
+
+
+size_t Rewind::memory() const
+{
+    ENTER_FUNCTION(Rewind::memory);
+
+    size_t bytes = 0;
+    for(int i=0; i<m_count; ++i)
+        bytes += at(i).data.size();
+    return bytes;
+}
+
+
+bool Rewind::save(const std::string& filename) const
+{
+    ENTER_FUNCTION(Rewind::save);
+
+    std::ofstream outfile(filename.c_str(), std::ios::out | std::ios::binary);
+    if(!outfile) {
+        std::cerr << "Couldn't open rewind file - " << filename << std::endl;
+        return false;
+    }
+
+    std::vector<unsigned char> frame, size;
+    for(int i=m_count-1; i>=0; --i) {
+        this->frame(i, &frame);
+
+        size.clear();
+        put32(&size, frame.size());
+        outfile.write(reinterpret_cast<const char*>(&size[0]), size.size());
+        if(!frame.empty()) outfile.write(reinterpret_cast<const char*>(&frame[0]), frame.size());
+    }
+
+    if(!outfile) {
+        std::cerr << "Couldn't write rewind file - " << filename << std::endl;
+        return false;
+    }
+    return true;
+}
+
+
+void Rewind::print(std::ostream& out) const
+{
+    ENTER_FUNCTION(Rewind::print);
+
+    int keyframes = 0;
+    for(int i=0; i<m_count; ++i)
+        if(at(i).key) ++keyframes;
+
+    out << "Rewind buffer has " << m_count << " of " << m_frames.size() << " frames ("
+        << keyframes << " keyframes) in " << memory() << " bytes" << std::endl;
+}
+
+
+void Rewind::drop_oldest()
+{
+    ENTER_FUNCTION(Rewind::drop_oldest);
+
+    // the deltas after the oldest keyframe can't be rebuilt without it
+    do {
+        m_first = (m_first + 1) % m_frames.size();
+        --m_count;
+    } while(m_count && !m_frames[m_first].key);
+}
+
+
+void Rewind::encode(const std::vector<unsigned char>& frame, const std::vector<unsigned char>& key, std::vector<unsigned char>* const delta)
+{
+    delta->clear();
+    put32(delta, frame.size());
+
+    const size_t size = frame.size();
+    size_t i = 0;
+    while(i < size) {
+        size_t same = 0;
+        while(i + same < size && same < MAX_RUN && frame[i + same] == key_byte(key, i + same))
+            ++same;
+        if(i + same == size) break;
+
+        size_t changed = 0;
+        while(i + same + changed < size && changed < MAX_RUN) {
+            const size_t j = i + same + changed;
+            if(frame[j] == key_byte(key, j)) {
+                size_t ahead = 1;
+                while(ahead < MIN_SAME_RUN && j + ahead < size && frame[j + ahead] == key_byte(key, j + ahead))
+                    ++ahead;
+                if(ahead == MIN_SAME_RUN || j + ahead == size) break;
+            }
+            ++changed;
+        }
+
+        put16(delta, same);
+        put16(delta, changed);
+        for(size_t k=i+same; k<i+same+changed; ++k)
+            delta->push_back(frame[k] ^ key_byte(key, k));
+
+        i += same + changed;
+    }
+}
+
+
+void Rewind::decode(const std::vector<unsigned char>& delta, const std::vector<unsigned char>& key, std::vector<unsigned char>* const frame)
+{
+    const size_t size = get32(delta, 0);
+    frame->assign(key.begin(), key.begin() + std::min(size, key.size()));
+    frame->resize(size, 0);
+
+    size_t pos = 4, i = 0;
+    while(pos < delta.size()) {
+        const size_t same = get16(delta, pos);
+        const size_t changed = get16(delta, pos + 2);
+        pos += 4;
+
+        i += same;
+        for(size_t k=0; k<changed; ++k)
+            (*frame)[i + k] ^= delta[pos++];
+        i += changed;
+    }
+}
@@ -25,7 +25,6 @@ Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
 #include "Audio.h"
 #include "World.h"
 #include "Blaster.h"
-#include "BlueCollarSuit.h"
 #include "state.h"
 
 
@@ -35,9 +34,9 @@ Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
  */
 
 
-const std::string Skratch::IDLE_ANIMATION_FILENAME(DATADIR "/characters/skratch/idle.tga");
-const std::string Skratch::RUN1_ANIMATION_FILENAME(DATADIR "/characters/skratch/run1.tga");
-const std::string Skratch::RUN2_ANIMATION_FILENAME(DATADIR "/characters/skratch/run2.tga");
+const std::string Skratch::ANIMATION_DIRECTORY(DATADIR "/characters/skratch");
+const std::string Skratch::IDLE_CLIP("idle");
+const std::string Skratch::RUN_CLIP("run");
 
 const std::string Skratch::JUMP_SOUND_FILENAME(DATADIR "/characters/skratch/jump.wav");
 
@@ -48,6 +47,59 @@ const float Skratch::JUMP_VEL = 650.0f;
 
 
 
+/*
+ *  Skratch class functions
+ *
+ */
+
+
+void Skratch::register_collision_handlers()
+{
+    ENTER_FUNCTION(Skratch::register_collision_handlers);
+
+    Entity::set_collision_handler(PlayerLayer, PickupLayer, on_pickup_collision);
+    Entity::set_collision_handler(PlayerLayer, EnemyLayer, on_enemy_collision);
+}
+
+
+void Skratch::on_pickup_collision(Entity* const entity, Entity* const pickup)
+{
+    ENTER_FUNCTION(Skratch::on_pickup_collision);
+
+    Skratch* const skratch = static_cast<Skratch*>(entity);
+
+    // the blaster is the only pickup so far
+    pickup->set_removable();
+    give_blaster(skratch);
+}
+
+
+void Skratch::on_enemy_collision(Entity* const entity, Entity* const enemy)
+{
+    ENTER_FUNCTION(Skratch::on_enemy_collision);
+
+    entity->set_removable();
+}
+
+
+void Skratch::give_blaster(Skratch* const skratch)
+{
+    ENTER_FUNCTION(Skratch::give_blaster);
+
+    std::auto_ptr<Blaster> b(new Blaster(false));
+    skratch->m_blaster = b;
+    skratch->m_blaster->load_sounds();
+}
+
+
+void Skratch::load_archetype(Archetype* const archetype, const VideoState& video_state)
+{
+    ENTER_FUNCTION(Skratch::load_archetype);
+
+    archetype->load_clips(ANIMATION_DIRECTORY, DefaultWidth, DefaultHeight, video_state);
+}
+
+
 /*
  *  Skratch methods
  *
@@ -58,8 +110,9 @@ Skratch::Skratch() : Entity(false), m_can_jump(false), m_state(IdleRight), m_bla
 {
     ENTER_FUNCTION(Skratch::Skratch);
 
-    m_mass = MASS;
-    memset(m_sprite_indexes, -1, AnimationCount * sizeof(int));
+    set_type(this);
+    set_mass(MASS);
+    set_collision_layer(PlayerLayer, layer_bit(EnemyLayer) | layer_bit(PickupLayer));
     memset(m_sound_indexes, -1, SoundCount * sizeof(int));
 }
 
@@ -79,13 +132,13 @@ void Skratch::think(const VideoState& video_state, bool* const keystate, const W
     ENTER_FUNCTION(Skratch::think);
 
     if(keystate[SDLK_RIGHT]) {
-        m_acceleration./*add*/set_x(HORIZONTAL_ACCEL);
+        set_acceleration_x(HORIZONTAL_ACCEL);
         set_state(RunningRight);
     } else if(keystate[SDLK_LEFT]) {
-        m_acceleration./*add*/set_x(-HORIZONTAL_ACCEL);
+        set_acceleration_x(-HORIZONTAL_ACCEL);
         set_state(RunningLeft);
     } else {
-        m_acceleration.clear_x();
+        set_acceleration_x(0.0f);
 
         if(m_state == RunningRight) set_state(IdleRight);
         else if(m_state == RunningLeft) set_state(IdleLeft);
@@ -105,8 +158,8 @@ void Skratch::think(const VideoState& video_state, bool* const keystate, const W
     if(keystate[SDLK_SPACE] && m_can_jump) {
         keystate[SDLK_SPACE] = false;
         Audio::play_sound(m_sound_indexes[JumpSound]);
-        m_velocity./*set*/add_y(-JUMP_VEL);
-    } else m_acceleration.clear_y();
+        add_velocity_y(-JUMP_VEL);
+    } else set_acceleration_y(0.0f);
 
     if((keystate[SDLK_LCTRL] || keystate[SDLK_RCTRL]) && m_blaster.get())
         m_blaster->shoot(video_state, *this, world);
@@ -117,17 +170,8 @@ void Skratch::load_sprites(const VideoState& video_state)
 {
     ENTER_FUNCTION(Skratch::load_sprites);
 
-    m_sprite_indexes[IdleRightAnimation] = Entity::load_sprite(IDLE_ANIMATION_FILENAME, DefaultWidth, DefaultHeight, video_state);
-    m_sprite_indexes[IdleLeftAnimation]  = Video::flip_surface_horizontal(m_sprite_indexes[IdleRightAnimation], "skratch_idle_left");
-    m_sprite_indexes[Run1RightAnimation] = Entity::load_sprite(RUN1_ANIMATION_FILENAME, DefaultWidth, DefaultHeight, video_state);
-    m_sprite_indexes[Run2RightAnimation] = Entity::load_sprite(RUN2_ANIMATION_FILENAME, DefaultWidth, DefaultHeight, video_state);
-    m_sprite_indexes[Run1LeftAnimation]  = Video::flip_surface_horizontal(m_sprite_indexes[Run1RightAnimation], "skratch_run1_left");
-    m_sprite_indexes[Run2LeftAnimation]  = Video::flip_surface_horizontal(m_sprite_indexes[Run2RightAnimation], "skratch_run2_left");
-
-    for(int i=0; i<AnimationCount; ++i)
-        Video::set_color_key(m_sprite_indexes[i], 0, 255, 0);
-
-    m_current_sprite_index = m_sprite_indexes[IdleRightAnimation];
+    use_archetype("skratch", load_archetype, video_state);
+    set_state(m_state);
 }
 
 
@@ -139,72 +183,57 @@ void Skratch::load_sounds()
 }
 
 
-void Skratch::on_animate(float dt, const std::bitset<World::CollisionSize>& collision_types, const World& world)
+void Skratch::save_state(SavedState* const saved) const
 {
-    ENTER_FUNCTION(Skratch::on_animate);
+    ENTER_FUNCTION(Skratch::save_state);
 
-    if(m_position.x() < 0.0f)
-        m_position.clear_x();
-    if(m_position.y() < 0.0f)
-        m_position.clear_y();
+    saved->state = m_state;
+    saved->can_jump = m_can_jump ? 1 : 0;
+    saved->has_blaster = has_blaster() ? 1 : 0;
+    saved->cool_time = has_blaster() ? m_blaster->cool_time() : 0.0f;
+}
 
-    m_can_jump = collision_types[World::BottomCollision];
 
-    // don't go too fast
-    if(m_velocity.x() > MAX_HORIZONTAL_VEL)
-        m_velocity.set_x(MAX_HORIZONTAL_VEL);
-    else if(m_velocity.x() < -MAX_HORIZONTAL_VEL)
-        m_velocity.set_x(-MAX_HORIZONTAL_VEL);
+void Skratch::load_state(const SavedState& saved)
+{
+    ENTER_FUNCTION(Skratch::load_state);
 
-    if(has_blaster())
-        m_blaster->lower_cool_time(dt);
+    // not set_state(), the clip he was playing comes back with the other entities
+    m_state = static_cast<SkratchState>(saved.state);
+    m_can_jump = (saved.can_jump != 0);
 
-    m_animation_seconds += dt;
-    switch(m_state)
-    {
-    case RunningLeft:
-        if(m_animation_seconds >= 0.0f && m_animation_seconds < 0.25f)
-            m_current_sprite_index = m_sprite_indexes[Run1LeftAnimation];
-        else if(m_animation_seconds >= 0.25f && m_animation_seconds < 0.5f)
-            m_current_sprite_index = m_sprite_indexes[IdleLeftAnimation];
-        else if(m_animation_seconds >= 0.5f && m_animation_seconds < 0.75f)
-            m_current_sprite_index = m_sprite_indexes[Run2LeftAnimation];
-        else if(m_animation_seconds >= 0.75f && m_animation_seconds < 1.0f)
-            m_current_sprite_index = m_sprite_indexes[IdleLeftAnimation];
-        else
-            m_animation_seconds = 0.0f;
-        break;
-    case RunningRight:
-        if(m_animation_seconds >= 0.0f && m_animation_seconds < 0.25f)
-            m_current_sprite_index = m_sprite_indexes[Run1RightAnimation];
-        else if(m_animation_seconds >= 0.25f && m_animation_seconds < 0.5f)
-            m_current_sprite_index = m_sprite_indexes[IdleRightAnimation];
-        else if(m_animation_seconds >= 0.5f && m_animation_seconds < 0.75f)
-            m_current_sprite_index = m_sprite_indexes[Run2RightAnimation];
-        else if(m_animation_seconds >= 0.75f && m_animation_seconds < 1.0f)
-            m_current_sprite_index = m_sprite_indexes[IdleRightAnimation];
-        else
-            m_animation_seconds = 0.0f;
-        break;
-    default: break;
+    // rewinding past the pickup brings the pickup back, so he has to lose the blaster again
+    if(!saved.has_blaster) m_blaster.reset();
+    else {
+        if(!has_blaster()) give_blaster(this);
+        m_blaster->set_cool_time(saved.cool_time);
     }
-
-//std::cout << "Skratch's position: " << m_position << "\tvelocity: " << m_velocity << "\tacceleration: " << m_acceleration << std::endl;
 }
 
 
-void Skratch::on_collision(Entity* const entity)
+void Skratch::on_animate(float dt, const std::bitset<World::CollisionSize>& collision_types, const World& world)
 {
-    ENTER_FUNCTION(Skratch::on_collision);
+    ENTER_FUNCTION(Skratch::on_animate);
+
+    const Vector<float> p(position());
+    if(p.x() < 0.0f)
+        set_position_x(0.0f);
+    if(p.y() < 0.0f)
+        set_position_y(0.0f);
 
-    if(typeid(*entity) == typeid(Blaster)) {
-        entity->set_removable();
+    m_can_jump = collision_types[World::BottomCollision];
+
+    // don't go too fast
+    const Vector<float> v(velocity());
+    if(v.x() > MAX_HORIZONTAL_VEL)
+        set_velocity_x(MAX_HORIZONTAL_VEL);
+    else if(v.x() < -MAX_HORIZONTAL_VEL)
+        set_velocity_x(-MAX_HORIZONTAL_VEL);
 
-        std::auto_ptr<Blaster> b(new Blaster(false));
-        m_blaster = b;
-        m_blaster->load_sounds();
-    } else if(typeid(*entity) == typeid(BlueCollarSuit))
-        set_removable();
+    if(has_blaster())
+        m_blaster->lower_cool_time(dt);
+
+//std::cout << "Skratch's position: " << position() << "\tvelocity: " << velocity() << "\tacceleration: " << acceleration() << std::endl;
 }
 
 
@@ -215,21 +244,18 @@ void Skratch::set_state(int state)
     switch(state)
     {
     case IdleLeft:
-        m_current_sprite_index = m_sprite_indexes[IdleLeftAnimation];
+        play(IDLE_CLIP, true);
         break;
     case IdleRight:
-        m_current_sprite_index = m_sprite_indexes[IdleRightAnimation];
+        play(IDLE_CLIP, false);
         break;
     case RunningLeft:
-        m_current_sprite_index = m_sprite_indexes[Run1LeftAnimation];
+        play(RUN_CLIP, true);
         break;
     case RunningRight:
-        m_current_sprite_index = m_sprite_indexes[Run1RightAnimation];
+        play(RUN_CLIP, false);
         break;
     default: return;
     }
-
-    if(state != m_state)
-        m_animation_seconds = 0.0f;
     m_state = static_cast<SkratchState>(state);
 }
@@ -0,0 +1,166 @@
+/**
+\file SpatialHash.cc
+\author Shane Lillie
+\brief Spatial hash broadphase source.
+
+\verbatim
+Copyright 2002-2003 Energon Software
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2, or (at your option)
+any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software Foundation,
+Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+\endverbatim
+*/
+
+
+#include "shared.h"
+#include "SpatialHash.h"
+
+
+/*
+ *  functions
+ *
+ */
+
+
+/**
+\brief Divides, rounding towards negative infinity.
+*/
+inline int floor_divide(int numerator, int denominator)
+{
+    const int quotient = numerator / denominator;
+    return (numerator % denominator < 0) ? quotient - 1 : quotient;
+}
+
+
+/*
+ *  SpatialHash methods
+ *
+ */
+
+
+SpatialHash::SpatialHash() : m_cell_width(1), m_cell_height(1), m_buckets(MinBucketCount), m_stamp(0)
+{
+    ENTER_FUNCTION(SpatialHash::SpatialHash);
+}
+
+
+void SpatialHash::clear(int cell_width, int cell_height, size_t expected)
+{
+    ENTER_FUNCTION(SpatialHash::clear);
+
+    m_cell_width = cell_width > 0 ? cell_width : 1;
+    m_cell_height = cell_height > 0 ? cell_height : 1;
+
+    m_entries.clear();
+    m_entries.reserve(expected);
+
+    // keep roughly two buckets per entry so chains stay short
+    size_t bucket_count = MinBucketCount;
+    while(bucket_count < (expected << 1))
+        bucket_count <<= 1;
+
+    if(bucket_count > m_buckets.size()) {
+        m_buckets.clear();
+        m_buckets.resize(bucket_count);
+    } else {
+        for(std::vector<size_t>::const_iterator it = m_used_buckets.begin(); it != m_used_buckets.end(); ++it)
+            m_buckets[*it].clear();
+    }
+    m_used_buckets.clear();
+}
+
+
+void SpatialHash::insert(Entity* const entity, int left, int top, int right, int bottom, unsigned int layers, unsigned int mask)
+{
+    ENTER_FUNCTION(SpatialHash::insert);
+
+    // nothing will ever be handed this back, so don't bother
+    if(!layers || !mask) return;
+
+    const int index = static_cast<int>(m_entries.size());
+    m_entries.push_back(Entry(entity, left, top, right, bottom, layers, mask));
+
+    const int first_column = column(left), last_column = column(right);
+    const int first_row = row(top), last_row = row(bottom);
+    for(int y=first_row; y<=last_row; ++y) {
+        for(int x=first_column; x<=last_column; ++x) {
+            const size_t b = bucket(x, y);
+            if(m_buckets[b].empty())
+                m_used_buckets.push_back(b);
+            m_buckets[b].push_back(index);
+        }
+    }
+}
+
+
+void SpatialHash::query(int left, int top, int right, int bottom, unsigned int layers, unsigned int mask, std::vector<Entity*>* const candidates)
+{
+    ENTER_FUNCTION(SpatialHash::query);
+
+    candidates->clear();
+    if(!layers || !mask) return;
+
+    // stamps keep entries that span (or hash into) several buckets from showing up twice
+    if(!++m_stamp) {
+        for(std::vector<Entry>::iterator it = m_entries.begin(); it != m_entries.end(); ++it)
+            it->stamp = 0;
+        m_stamp = 1;
+    }
+
+    const int first_column = column(left), last_column = column(right);
+    const int first_row = row(top), last_row = row(bottom);
+    for(int y=first_row; y<=last_row; ++y) {
+        for(int x=first_column; x<=last_column; ++x) {
+            const std::vector<int>& chain = m_buckets[bucket(x, y)];
+            for(std::vector<int>::const_iterator it = chain.begin(); it != chain.end(); ++it) {
+                Entry& entry = m_entries[*it];
+                if(entry.stamp == m_stamp) continue;
+                entry.stamp = m_stamp;
+
+                // layers that don't care about each other never make it to the narrow test
+                if(!(entry.layers & mask) || !(entry.mask & layers))
+                    continue;
+
+                // different cells can share a bucket, so check the actual bounds
+                if(entry.right < left || entry.left > right || entry.bottom < top || entry.top > bottom)
+                    continue;
+                m_hits.push_back(*it);
+            }
+        }
+    }
+
+    // hand them back in insertion order so collision responses don't depend on the hashing
+    std::sort(m_hits.begin(), m_hits.end());
+    for(std::vector<int>::const_iterator it = m_hits.begin(); it != m_hits.end(); ++it)
+        candidates->push_back(m_entries[*it].entity);
+    m_hits.clear();
+}
+
+
+size_t SpatialHash::bucket(int column, int row) const
+{
+    return ((static_cast<unsigned int>(column) * 73856093U) ^ (static_cast<unsigned int>(row) * 19349663U)) & (m_buckets.size() - 1);
+}
+
+
+int SpatialHash::column(int x) const
+{
+    return floor_divide(x, m_cell_width);
+}
+
+
+int SpatialHash::row(int y) const
+{
+    return floor_divide(y, m_cell_height);
+}
@@ -0,0 +1,134 @@
+/**
+\file TileCache.cc
+\author Shane Lillie
+\brief Pre-rendered tile chunk cache source.
+
+\verbatim
+Copyright 2002-2003 Energon Software
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2, or (at your option)
+any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software Foundation,
+Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+\endverbatim
+*/
+
+
+
+#include "shared.h"
+#include "TileCache.h"
+#include "Video.h"
+
+
+/*
+ *  TileCache class functions
+ *
+ */
+
+
+TileCache::TileCache()
+    : m_capacity(0), m_clock(0), m_chunk_width(1), m_chunk_height(1), m_columns(0), m_rows(0)
+{
+    ENTER_FUNCTION(TileCache::TileCache);
+}
+
+
+TileCache::~TileCache() throw()
+{
+    ENTER_FUNCTION(TileCache::~TileCache);
+
+    clear();
+}
+
+
+void TileCache::reset(int chunk_width, int chunk_height, int world_width, int world_height, int capacity)
+{
+    ENTER_FUNCTION(TileCache::reset);
+
+    clear();
+
+    m_chunk_width = std::max(1, chunk_width);
+    m_chunk_height = std::max(1, chunk_height);
+    m_columns = (world_width + m_chunk_width - 1) / m_chunk_width;
+    m_rows = (world_height + m_chunk_height - 1) / m_chunk_height;
+    m_capacity = capacity;
+}
+
+
+void TileCache::clear()
+{
+    ENTER_FUNCTION(TileCache::clear);
+
+    for(std::vector<Entry>::iterator it = m_entries.begin(); it != m_entries.end(); ++it)
+        SDL_FreeSurface(it->surface);
+    m_entries.clear();
+    m_clock = 0;
+}
+
+
+SDL_Surface* TileCache::find(int chunk)
+{
+    ENTER_FUNCTION(TileCache::find);
+
+    for(std::vector<Entry>::iterator it = m_entries.begin(); it != m_entries.end(); ++it) {
+        if(it->chunk == chunk) {
+            it->used = ++m_clock;
+            return it->surface;
+        }
+    }
+    return NULL;
+}
+
+
+SDL_Surface* TileCache::allocate(int chunk)
+{
+    ENTER_FUNCTION(TileCache::allocate);
+
+    Entry* entry = NULL;
+    if(static_cast<int>(m_entries.size()) < m_capacity) {
+        Entry e;
+        e.surface = Video::create_surface(m_chunk_width, m_chunk_height);
+        if(!e.surface) {
+            std::cerr << "Couldn't create tile chunk surface: " << SDL_GetError() << std::endl;
+            return NULL;
+        }
+        SDL_SetColorKey(e.surface, SDL_SRCCOLORKEY, SDL_MapRGB(e.surface->format, 0, 255, 0));
+
+        m_entries.push_back(e);
+        entry = &m_entries.back();
+    } else {
+        // free surfaces have never been used since they were freed, so they go first
+        for(std::vector<Entry>::iterator it = m_entries.begin(); it != m_entries.end(); ++it) {
+            if(!entry || it->used < entry->used)
+                entry = &(*it);
+        }
+        if(!entry) return NULL;
+    }
+
+    entry->chunk = chunk;
+    entry->used = ++m_clock;
+    SDL_FillRect(entry->surface, NULL, SDL_MapRGB(entry->surface->format, 0, 255, 0));
+    return entry->surface;
+}
+
+
+void TileCache::invalidate(int chunk)
+{
+    ENTER_FUNCTION(TileCache::invalidate);
+
+    for(std::vector<Entry>::iterator it = m_entries.begin(); it != m_entries.end(); ++it) {
+        if(it->chunk == chunk) {
+            it->chunk = -1;
+            it->used = 0;
+        }
+    }
+}
@@ -0,0 +1,151 @@
+/**
+\file Tileset.cc
+\author Shane Lillie
+\brief Level tile image registry source.
+
+\verbatim
+Copyright 2002-2003 Energon Software
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2, or (at your option)
+any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software Foundation,
+Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+\endverbatim
+*/
+
+
+#include "shared.h"
+#include "Tileset.h"
+#include "Video.h"
+
+
+/*
+ *  Tileset class variables
+ *
+ */
+
+
+std::vector<int> Tileset::surfaces;
+int Tileset::block_width = 0;
+int Tileset::block_height = 0;
+
+
+/*
+ *  Tileset class functions
+ *
+ */
+
+
+int Tileset::load(int tile, int width, int height)
+{
+    ENTER_FUNCTION(Tileset::load);
+
+    if(tile <= 0) return -1;
+
+    reserve(tile, width, height);
+    if(surfaces[tile] >= 0) return surfaces[tile];
+
+    surfaces[tile] = Video::scale_surface(Video::load_image(filename(tile)), width, height);
+    return surfaces[tile];
+}
+
+
+SDL_Surface* Tileset::decode(int tile, int width, int height)
+{
+    ENTER_FUNCTION(Tileset::decode);
+
+    if(tile <= 0) return NULL;
+
+    SDL_Surface* const image = Video::decode_image(filename(tile));
+    if(!image) return NULL;
+
+    SDL_Surface* const scaled = Video::scale_copy(image, width, height);
+    SDL_FreeSurface(image);
+    return scaled;
+}
+
+
+int Tileset::adopt(int tile, int width, int height, SDL_Surface* const image)
+{
+    ENTER_FUNCTION(Tileset::adopt);
+
+    if(tile <= 0 || !image) {
+        if(image) SDL_FreeSurface(image);
+        return -1;
+    }
+
+    reserve(tile, width, height);
+    if(surfaces[tile] >= 0) {
+        SDL_FreeSurface(image);
+        return surfaces[tile];
+    }
+
+    // registered under the file name, so clear() and load_image() treat it like a loaded tile
+    SDL_Surface* const surface = SDL_DisplayFormat(image);
+    SDL_FreeSurface(image);
+    if(!surface) return -1;
+
+    surfaces[tile] = Video::push_back(surface, filename(tile));
+    return surfaces[tile];
+}
+
+
+void Tileset::clear()
+{
+    ENTER_FUNCTION(Tileset::clear);
+
+    // unloading makes the next load_image() go back to the file instead of the scaled copy
+    for(std::vector<int>::const_iterator it = surfaces.begin(); it != surfaces.end(); ++it)
+        if(*it >= 0) Video::unload_surface(*it);
+
+    surfaces.clear();
+    block_width = block_height = 0;
+}
+
+
+void Tileset::print_tiles(std::ostream& out)
+{
+    ENTER_FUNCTION(Tileset::print_tiles);
+
+    int count = 0;
+    for(std::vector<int>::const_iterator it = surfaces.begin(); it != surfaces.end(); ++it)
+        if(*it >= 0) ++count;
+
+    out << "I have " << count << " tiles at " << block_width << "x" << block_height << ":";
+    for(int i=0; i<static_cast<int>(surfaces.size()); ++i)
+        if(surfaces[i] >= 0) out << " " << i << "=" << surfaces[i];
+    out << std::endl;
+}
+
+
+std::string Tileset::filename(int tile)
+{
+    char filename[256];
+    snprintf(filename, 256,  DATADIR "/levels/blocks/block%02d.tga", tile);
+    return filename;
+}
+
+
+void Tileset::reserve(int tile, int width, int height)
+{
+    ENTER_FUNCTION(Tileset::reserve);
+
+    // the scaled images are no good at another size
+    if(width != block_width || height != block_height) {
+        clear();
+        block_width = width;
+        block_height = height;
+    }
+
+    if(tile >= static_cast<int>(surfaces.size()))
+        surfaces.resize(tile + 1, -1);
+}
@@ -22,6 +22,7 @@ Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
 #include "shared.h"
 #include "Video.h"
 #include "Font.h"
+#include "DirtyRects.h"
 
 
 /*
@@ -55,6 +56,8 @@ std::vector<Video::Surface> Video::surface_vector;
 SDL_Surface* Video::window = NULL;
 Uint32 Video::flags = 0;
 
+DirtyRects* Video::dirty_rects = NULL;
+
 
 /*
  *  Video class functions
@@ -188,6 +191,27 @@ int Video::load_image(const std::string& filename)
 }
 
 
+SDL_Surface* Video::decode_image(const std::string& filename)
+{
+    ENTER_FUNCTION(Video::decode_image);
+
+    if(filename.empty()) return NULL;
+
+    SDL_Surface* surface = IMG_Load(filename.c_str());
+    if(!surface) surface = IMG_Load(NOIMAGE);
+    if(!surface) return NULL;
+
+    // get_pixel() and put_pixel() copy raw pixels, so put everything in one format
+    SDL_Surface* surf = SDL_CreateRGBSurface(SDL_SWSURFACE, surface->w, surface->h, 32, RMASK, GMASK, BMASK, AMASK);
+    if(surf) {
+        SDL_SetAlpha(surface, 0, 0);
+        SDL_BlitSurface(surface, NULL, surf, NULL);
+    }
+    SDL_FreeSurface(surface);
+    return surf;
+}
+
+
 int Video::push_back(SDL_Surface* const surface, const std::string& name)
 {
     ENTER_FUNCTION(Video::push_back);
@@ -243,6 +267,17 @@ int Video::copy_surface(SDL_Surface* const surface, const std::string& name)
 }
 
 
+SDL_Surface* Video::create_surface(int width, int height)
+{
+    ENTER_FUNCTION(Video::create_surface);
+
+    if(!window || width <= 0 || height <= 0) return NULL;
+
+    const SDL_PixelFormat* const format = window->format;
+    return SDL_CreateRGBSurface(SDL_SWSURFACE, width, height, format->BitsPerPixel, format->Rmask, format->Gmask, format->Bmask, format->Amask);
+}
+
+
 int Video::scale_surface(int index, int width, int height, const std::string& name)
 {
     ENTER_FUNCTION(Video::scale_surface);
@@ -256,15 +291,31 @@ int Video::scale_surface(SDL_Surface* const surface, int width, int height, cons
 {
     ENTER_FUNCTION(Video::scale_surface);
 
+    if(!surface || width <= 0 || height <= 0) return -1;
+
+    // don't scale if we don't have to
+    if(width == surface->w && height == surface->h) return copy_surface(surface, name);
+
+    SDL_Surface* surf = scale_copy(surface, width, height);
+    if(surf) {
+        surface_vector.push_back(Surface(name, SDL_DisplayFormat(surf), surface_size()));
+        SDL_FreeSurface(surf);
+        return surface_size() - 1;
+    }
+    return -1;
+}
+
+
+SDL_Surface* Video::scale_copy(SDL_Surface* const surface, int width, int height)
+{
 /*
 This uses a modified bi-linear filtering algorithm from
 "Tricks of the Windows Game Programming Gurus" (Lamothe, 1999 Sams, p. 371)
 */
 
-    if(!surface || width <= 0 || height <= 0) return -1;
+    ENTER_FUNCTION(Video::scale_copy);
 
-    // don't scale if we don't have to
-    if(width == surface->w && height == surface->h) return copy_surface(surface, name);
+    if(!surface || width <= 0 || height <= 0) return NULL;
 
     SDL_Surface* surf = SDL_CreateRGBSurface(surface->flags, width, height, surface->format->BitsPerPixel, RMASK, GMASK, BMASK, AMASK);
     if(surf) {
@@ -289,12 +340,8 @@ This uses a modified bi-linear filtering algorithm from
 
         if(SDL_MUSTLOCK(surface)) SDL_UnlockSurface(surface);
         if(SDL_MUSTLOCK(surf)) SDL_UnlockSurface(surf);
-
-        surface_vector.push_back(Surface(name, SDL_DisplayFormat(surf), surface_size()));
-        SDL_FreeSurface(surf);
-        return surface_size() - 1;
     }
-    return -1;
+    return surf;
 }
 
 
@@ -446,7 +493,7 @@ void Video::render_surface(int index, SDL_Rect* const srcrect, SDL_Rect* const p
     ENTER_FUNCTION(Video::render_surface);
 
     if(index >= surface_size() || index < 0 || !surface_vector[index].surface) return;
-    if(window) SDL_BlitSurface(surface_vector[index].surface, srcrect, window, pos);
+    render_surface(surface_vector[index].surface, srcrect, pos);
 }
 
 
@@ -454,8 +501,19 @@ void Video::render_surface(SDL_Surface* const src, SDL_Rect* const srcrect, SDL_
 {
     ENTER_FUNCTION(Video::render_surface);
 
-    if(!src) return;
-    if(window) SDL_BlitSurface(src, srcrect, window, pos);
+    if(!src || !window) return;
+
+    // the blit clips pos to what it actually drew
+    SDL_BlitSurface(src, srcrect, window, pos);
+    if(dirty_rects) {
+        if(pos) dirty_rects->add(*pos);
+        else {
+            SDL_Rect all;
+            all.x = 0; all.y = 0;
+            all.w = window->w; all.h = window->h;
+            dirty_rects->add(all);
+        }
+    }
 }
 
 
@@ -598,7 +656,10 @@ void Video::render_text(const Font& font, const std::string& text, int x, int y)
 {
     ENTER_FUNCTION(Video::render_text);
 
-    if(window) font.render_text(text, window, x, y);
+    if(!window) return;
+
+    const SDL_Rect area = font.render_text(text, window, x, y);
+    if(dirty_rects) dirty_rects->add(area);
 }
 
 
@@ -618,6 +679,39 @@ void Video::flip()
 }
 
 
+void Video::update_rects(std::vector<SDL_Rect>& rects)
+{
+    ENTER_FUNCTION(Video::update_rects);
+
+    if(window && !rects.empty()) SDL_UpdateRects(window, static_cast<int>(rects.size()), &rects[0]);
+}
+
+
+void Video::set_clip_rect(SDL_Rect* const rect)
+{
+    ENTER_FUNCTION(Video::set_clip_rect);
+
+    if(window) SDL_SetClipRect(window, rect);
+}
+
+
+void Video::set_dirty_rects(DirtyRects* const dirty)
+{
+    ENTER_FUNCTION(Video::set_dirty_rects);
+
+    dirty_rects = dirty;
+}
+
+
+void Video::disable_double_buffer()
+{
+    ENTER_FUNCTION(Video::disable_double_buffer);
+
+    flags &= ~(SDL_HWSURFACE | SDL_DOUBLEBUF);
+    flags |= SDL_SWSURFACE;
+}
+
+
 void Video::show_cursor()
 {
     ENTER_FUNCTION(Video::show_cursor);
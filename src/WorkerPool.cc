@@ -0,0 +1,203 @@
+/**
+\file WorkerPool.cc
+\author Shane Lillie
+\brief Worker thread pool source.
+
+\verbatim
+Copyright 2002-2003 Energon Software
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2, or (at your option)
+any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software Foundation,
+Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+\endverbatim
+*/
+
+
+#include "shared.h"
+#include "WorkerPool.h"
+
+
+/*
+ *  WorkerPool class variables
+ *
+ */
+
+
+std::vector<SDL_Thread*> WorkerPool::workers;
+std::vector<Uint32> WorkerPool::worker_ids;
+
+SDL_mutex* WorkerPool::lock = NULL;
+SDL_cond* WorkerPool::work_ready = NULL;
+SDL_cond* WorkerPool::work_done = NULL;
+
+WorkerPool::Job WorkerPool::job = NULL;
+const void* WorkerPool::job_data = NULL;
+int WorkerPool::job_count = 0;
+
+unsigned long WorkerPool::generation = 0;
+int WorkerPool::pending = 0;
+bool WorkerPool::stopping = false;
+
+
+/*
+ *  WorkerPool class functions
+ *
+ */
+
+
+bool WorkerPool::start(int count)
+{
+    ENTER_FUNCTION(WorkerPool::start);
+
+    stop();
+    if(count <= 0) return true;
+
+#if defined DEBUG
+    std::cerr << "Debug builds can't track the call stack across threads, not starting any workers" << std::endl;
+    return false;
+#else
+    lock = SDL_CreateMutex();
+    work_ready = SDL_CreateCond();
+    work_done = SDL_CreateCond();
+    if(!lock || !work_ready || !work_done) {
+        std::cerr << "Couldn't create the worker pool locks: " << SDL_GetError() << std::endl;
+        stop();
+        return false;
+    }
+
+    SDL_LockMutex(lock);
+
+    stopping = false;
+    pending = count;
+    worker_ids.resize(count, 0);
+    for(int i=0; i<count; ++i) {
+        SDL_Thread* const thread = SDL_CreateThread(work, reinterpret_cast<void*>(static_cast<size_t>(i)));
+        if(!thread) {
+            std::cerr << "Couldn't create worker thread: " << SDL_GetError() << std::endl;
+            pending -= count - i;
+            break;
+        }
+        workers.push_back(thread);
+    }
+
+    // wait for everybody to check in so current_chunk() knows who they are
+    while(pending > 0)
+        SDL_CondWait(work_done, lock);
+
+    SDL_UnlockMutex(lock);
+
+    if(threads() < count) {
+        stop();
+        return false;
+    }
+    return true;
+#endif
+}
+
+
+void WorkerPool::stop()
+{
+    ENTER_FUNCTION(WorkerPool::stop);
+
+    if(lock) {
+        SDL_LockMutex(lock);
+        stopping = true;
+        if(work_ready) SDL_CondBroadcast(work_ready);
+        SDL_UnlockMutex(lock);
+    }
+
+    for(std::vector<SDL_Thread*>::iterator it = workers.begin(); it != workers.end(); ++it)
+        SDL_WaitThread(*it, NULL);
+    workers.clear();
+    worker_ids.clear();
+
+    if(work_done) SDL_DestroyCond(work_done);
+    if(work_ready) SDL_DestroyCond(work_ready);
+    if(lock) SDL_DestroyMutex(lock);
+    work_done = work_ready = NULL;
+    lock = NULL;
+}
+
+
+void WorkerPool::run(Job j, int count, const void* data)
+{
+    ENTER_FUNCTION(WorkerPool::run);
+
+    if(!threads()) {
+        j(0, count, 0, data);
+        return;
+    }
+
+    SDL_LockMutex(lock);
+
+    job = j;
+    job_data = data;
+    job_count = count;
+    pending = threads();
+    ++generation;
+    SDL_CondBroadcast(work_ready);
+
+    while(pending > 0)
+        SDL_CondWait(work_done, lock);
+
+    SDL_UnlockMutex(lock);
+}
+
+
+int WorkerPool::current_chunk()
+{
+    if(worker_ids.empty()) return -1;
+
+    const Uint32 id = SDL_ThreadID();
+    for(int i=0; i<threads(); ++i) {
+        if(worker_ids[i] == id)
+            return i;
+    }
+    return -1;
+}
+
+
+int WorkerPool::work(void* data)
+{
+    const int index = static_cast<int>(reinterpret_cast<size_t>(data));
+
+    SDL_LockMutex(lock);
+
+    worker_ids[index] = SDL_ThreadID();
+    unsigned long seen = generation;
+    if(--pending == 0)
+        SDL_CondSignal(work_done);
+
+    while(true) {
+        while(generation == seen && !stopping)
+            SDL_CondWait(work_ready, lock);
+        if(stopping) break;
+        seen = generation;
+
+        const int chunks = threads();
+        const int begin = static_cast<int>((static_cast<long>(job_count) * index) / chunks);
+        const int end = static_cast<int>((static_cast<long>(job_count) * (index + 1)) / chunks);
+        const Job j = job;
+        const void* const d = job_data;
+
+        SDL_UnlockMutex(lock);
+        if(begin < end) j(begin, end, index, d);
+        SDL_LockMutex(lock);
+
+        if(--pending == 0)
+            SDL_CondSignal(work_done);
+    }
+
+    SDL_UnlockMutex(lock);
+    return 0;
+}
@@ -22,6 +22,7 @@ Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
 #include "shared.h"
 #include "World.h"
 #include "Video.h"
+#include "Tileset.h"
 #include "Skratch.h"
 #include "Blaster.h"
 #include "BlueCollarSuit.h"
@@ -29,11 +30,6 @@ Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
 #include "state.h"
 
 
-// if this is defined, the world is scrolled parallaxically
-#define X_PARALLAX
-#define Y_PARALLAX
-
-
 /*
  *  functions
  *
@@ -70,6 +66,44 @@ inline int calc_grid_column(int grid_location, int grid_width)
 }
 
 
+/* moves the pixels of a surface by (dx, dy), leaving whatever was uncovered alone */
+void shift_surface(SDL_Surface* const surface, int dx, int dy)
+{
+    ENTER_FUNCTION(shift_surface);
+
+    const int bpp = surface->format->BytesPerPixel;
+    const int length = (surface->w - std::abs(dx)) * bpp;
+    const int rows = surface->h - std::abs(dy);
+    if(length <= 0 || rows <= 0) return;
+
+    if(SDL_MUSTLOCK(surface)) SDL_LockSurface(surface);
+
+    byte* const pixels = static_cast<byte*>(surface->pixels);
+    const int src_x = std::max(-dx, 0) * bpp;
+    const int dst_x = std::max(dx, 0) * bpp;
+
+    // walk the rows so none is overwritten before it's been moved
+    for(int i=0; i<rows; ++i) {
+        const int y = (dy > 0) ? (surface->h - 1 - i) : i;
+        std::memmove(pixels + (y * surface->pitch) + dst_x, pixels + ((y - dy) * surface->pitch) + src_x, length);
+    }
+
+    if(SDL_MUSTLOCK(surface)) SDL_UnlockSurface(surface);
+}
+
+
+/* boxes this close (in pixels) are touching, which covers rounding error */
+const float CONTACT_TOLERANCE = 0.01f;
+
+
+/* the fraction of the motion d before a gap closes */
+inline float contact_time(float gap, float d)
+{
+    if(gap < 0.0f && gap > -CONTACT_TOLERANCE) gap = 0.0f;
+    return gap / d;
+}
+
+
 /*
  *  World class constants
  *
@@ -87,74 +121,157 @@ const float World::FRICTION = 100.0f;
 
 
 World::World()
-    : m_width(0), m_height(0), m_block_width(0), m_block_height(0), m_blocks_wide(0), m_blocks_high(0), m_background_index(-1)
+    : m_width(0), m_height(0), m_block_width(0), m_block_height(0), m_blocks_wide(0), m_blocks_high(0),
+        m_scroll_reuse(false), m_tile_layer(NULL), m_tile_layer_valid(false), m_navigation_unsaved(false)
 {
     ENTER_FUNCTION(World::World);
 }
 
 
+World::~World() throw()
+{
+    ENTER_FUNCTION(World::~World);
+
+    free_decoded();
+    m_level.close();
+    if(m_tile_layer) SDL_FreeSurface(m_tile_layer);
+}
+
+
 bool World::load(const std::string& name, const VideoState& video_state, Skratch* const skratch)
 {
     ENTER_FUNCTION(World::load);
 
+    // the images are loaded by finish(), so the ones already in the video hash aren't read again
+    if(!prepare(name, video_state, false)) return false;
+    return finish(video_state, skratch);
+}
+
+
+bool World::prepare(const std::string& name, const VideoState& video_state, bool decode)
+{
+    ENTER_FUNCTION(World::prepare);
+
+    m_name.clear();
+    free_decoded();
+
     // this makes things faster when rendering and such
     m_block_width = static_cast<int>(DefaultBlockWidth * video_state.width_scale);
     m_block_height = static_cast<int>(DefaultBlockHeight * video_state.height_scale);
     m_blocks_wide = Video::window_width() / m_block_width;
     m_blocks_high = Video::window_height() / m_block_height;
+    m_scroll_reuse = video_state.scroll_reuse;
 
     const std::string path(DATADIR "/levels/" + name + "/");
-    if(!load_collision_map(path)) return false;
-    if(!load_texture_map(path)) return false;
-    if(!load_entity_map(path, video_state)) return false;
-    load_background(path);
+    if(!load_level(path)) return false;
+    read_background(path, video_state, decode);
+    load_navigation(name, video_state);
+    if(decode) decode_tiles();
 
-/* FIXME: is this really what we want? maybe in the entity map instead? */
-    skratch->set_position(Vector<float>(0.0f, static_cast<float>(m_position.y()), skratch->position().z()));
+    m_name = name;
+    return true;
+}
+
+
+bool World::finish(const VideoState& video_state, Skratch* const skratch)
+{
+    ENTER_FUNCTION(World::finish);
+
+    if(m_name.empty()) return false;
+
+    for(std::vector<std::pair<int, SDL_Surface*> >::const_iterator it = m_decoded_tiles.begin(); it != m_decoded_tiles.end(); ++it)
+        Tileset::adopt(it->first, m_block_width, m_block_height, it->second);
+    m_decoded_tiles.clear();
+
+    // only the tiles the level uses are loaded, and only the ones an earlier level didn't already load
+    for(int i=0; i<m_level.tile_id_count(); ++i)
+        Tileset::load(m_level.tile_id(i), m_block_width, m_block_height);
+
+    load_background(video_state);
+    save_navigation();
+    stream_chunks();
+
+    // the first frame shouldn't have to draw every chunk it's on
+    bake_chunks(m_position.x(), m_position.y(), Video::window_width(), Video::window_height(), -1, false);
+
+    spawn_entities(video_state);
+    place(skratch);
 
     return true;
 }
 
 
-void render_background(int background_index, int world_pixel_height, const Vector<int>& world_position)
+void World::snapshot(Snapshot* const snapshot) const
 {
-    ENTER_FUNCTION(render_background);
+    ENTER_FUNCTION(World::snapshot);
 
-    const int background_width = Video::at(background_index)->w;
-    const int background_height = Video::at(background_index)->h;
+    snapshot->name = m_name;
 
-#if defined X_PARALLAX
-    const int x_scroll = (world_position.x() >> 1) % background_width;
-#else
-    const int x_scroll = world_position.x() % background_width;
-#endif
+    snapshot->width = m_width;
+    snapshot->height = m_height;
+    snapshot->block_width = m_block_width;
+    snapshot->block_height = m_block_height;
+    snapshot->blocks_wide = m_blocks_wide;
+    snapshot->blocks_high = m_blocks_high;
+    snapshot->position = m_position;
+    snapshot->layers = m_layers;
 
-#if defined Y_PARALLAX
-    //const int y_scroll = (world_position.y() >> 1) % background_height;
-    const int y_scroll = ((world_position.y() + Video::window_height()) >> 1) % background_height;
-#else
-    const int y_scroll = world_position.y() % background_height;
-#endif
+    snapshot->spawns = m_spawns;
+}
 
-    SDL_Rect pos;
-    pos.x = 0; pos.y = 0;
 
-    SDL_Rect src;
-    src.x = x_scroll; src.y = y_scroll;
-    src.w = background_width - src.x;
-    src.h = Video::window_height();
+bool World::restore(const Snapshot& snapshot, const VideoState& video_state, Skratch* const skratch)
+{
+    ENTER_FUNCTION(World::restore);
 
-    Video::render_surface(background_index, &src, &pos);
+    // the tiles come out of this world's mapped level, so it has to be the same level
+    if(snapshot.name.empty() || snapshot.name != m_name) return false;
 
-    if(src.x != 0) {
-        pos.x = src.w; src.y = 0;
+    // the tile surfaces were scaled for the old block size
+    if(snapshot.block_width != static_cast<int>(DefaultBlockWidth * video_state.width_scale)
+        || snapshot.block_height != static_cast<int>(DefaultBlockHeight * video_state.height_scale))
+        return false;
 
-        src.x = 0; src.y = y_scroll;
-        src.w = background_width - pos.x;
-        src.h = Video::window_height();
+    m_name = snapshot.name;
+
+    m_width = snapshot.width;
+    m_height = snapshot.height;
+    m_block_width = snapshot.block_width;
+    m_block_height = snapshot.block_height;
+    m_blocks_wide = snapshot.blocks_wide;
+    m_blocks_high = snapshot.blocks_high;
+    m_position = snapshot.position;
+    m_layers = snapshot.layers;
+
+    m_spawns = snapshot.spawns;
+    m_scroll_velocity = Vector<int>();
+
+    // the cancelled chunks are cold again, so stream_chunks() has to be able to ask for them again
+    std::vector<int> cancelled;
+    m_level.cancel(&cancelled);
+    for(std::vector<int>::const_iterator it = cancelled.begin(); it != cancelled.end(); ++it) {
+        const std::vector<int>::iterator c = std::find(m_prefetched.begin(), m_prefetched.end(), *it);
+        if(c != m_prefetched.end()) {
+            *c = m_prefetched.back();
+            m_prefetched.pop_back();
+        }
+    }
 
-        Video::render_surface(background_index, &src, &pos);
+    // put back anything that was changed since the level loaded
+    if(!m_edits.empty()) {
+        for(std::map<int, int>::const_iterator it = m_edits.begin(); it != m_edits.end(); ++it)
+            m_tile_cache.invalidate(m_tile_cache.chunk_at((it->first % m_width) * m_block_width, (it->first / m_width) * m_block_height));
+        m_edits.clear();
+        build_collision();
     }
+    m_tile_layer_valid = false;
+    stream_chunks();
+    bake_chunks(m_position.x(), m_position.y(), Video::window_width(), Video::window_height(), -1, false);
+
+    spawn_entities(video_state);
+    place(skratch);
+
+    return true;
 }
 
 
@@ -162,37 +279,25 @@ void World::render()
 {
     ENTER_FUNCTION(World::render);
 
-    const int start_location = calc_grid_location(screen_to_grid_x(m_position.x(), m_block_width), screen_to_grid_y(m_position.y(), m_block_height), m_width);
-    const int start_x = calc_grid_column(start_location, m_width);
-    const int start_y = calc_grid_row(start_location, m_width);
+    render_background();
 
-    if(m_background_index >= 0) render_background(m_background_index, m_height * m_block_height, m_position);
+    if(m_scroll_reuse && render_tile_layer()) return;
+    draw_tiles(m_position.x(), m_position.y(), Video::window_width(), Video::window_height(), NULL, 0, 0);
+}
 
-    SDL_Rect pos;
-    pos.x = 0; pos.y = 0;
 
-    SDL_Rect src;
-    src.x = m_position.x() % m_block_width;
-    src.y = m_position.y() % m_block_height;
-    src.w = m_block_width - src.x;
-    src.h = m_block_height - src.y;
+void World::set_block(int x, int y, int tile, bool collidable)
+{
+    ENTER_FUNCTION(World::set_block);
 
-    for(int y=0; y<=m_blocks_high; ++y) {
-        for(int x=0; x<=m_blocks_wide; ++x) {
-            const int location = calc_grid_location(x + start_x, y + start_y, m_width);
-            if(m_blocks[location].surface_index >= 0)
-                Video::render_surface(m_blocks[location].surface_index, &src, &pos);
+    if(x < 0 || y < 0 || x >= m_width || y >= m_height) return;
 
-            pos.x += src.w;
-            src.x = 0; src.w = m_block_width;
-        }
-        pos.x = 0; pos.y += src.h;
+    Tileset::load(tile, m_block_width, m_block_height);
+    m_edits[(y * m_width) + x] = tile;
+    m_collision.set(x, y, collidable);
+    m_tile_layer_valid = false;
 
-        src.y = 0;
-        src.x = m_position.x() % m_block_width;
-        src.w = m_block_width - src.x;
-        src.h = m_block_height;
-    }
+    m_tile_cache.invalidate(m_tile_cache.chunk_at(x * m_block_width, y * m_block_height));
 }
 
 
@@ -208,6 +313,9 @@ void World::scroll(const Skratch& skratch)
     const int pixel_width = m_width * m_block_width;
     const int pixel_height = m_height * m_block_height;
 
+    const Vector<int> old_position(m_position);
+    m_player_feet = Vector<float>(skratch.position().x() + (skratch.width() >> 1), skratch.position().y() + skratch.height(), 0.0f);
+
     if(window_x > half_window_width) m_position.set_x(m_position.x() + (window_x - half_window_width));
     else if(window_x < half_window_width) m_position.set_x(m_position.x() - (half_window_width - window_x));
 
@@ -219,10 +327,271 @@ void World::scroll(const Skratch& skratch)
 
     if(m_position.y() < 0) m_position.clear_y();
     else if((m_position.y() + Video::window_height()) > pixel_height) m_position.set_y(pixel_height - Video::window_height());
+
+    m_scroll_velocity = Vector<int>(m_position.x() - old_position.x(), m_position.y() - old_position.y(), 0);
+    stream_chunks();
 }
 
 
 std::bitset<World::CollisionSize> World::collision(const Vector<float>& old_position, Vector<float>* const new_position, int entity_width, int entity_height) const
+{
+    ENTER_FUNCTION(World::collision);
+
+    std::bitset<CollisionSize> ret;
+
+    if(!new_position || entity_width < 0 || entity_height < 0) return ret;
+
+    Vector<float> p(old_position);
+    float dx = new_position->x() - old_position.x();
+    float dy = new_position->y() - old_position.y();
+
+    // the sweep ignores blocks the box is already in, so get it out of them first
+    ret |= depenetrate(&p, entity_width, entity_height);
+
+    // follow the path, sliding along whatever we hit (once per axis is all it can take)
+    for(int i=0; i<2 && (dx != 0.0f || dy != 0.0f); ++i) {
+        const Contact contact = sweep(p, dx, dy, entity_width, entity_height);
+        p.add_x(dx * contact.time);
+        p.add_y(dy * contact.time);
+        if(contact.time >= 1.0f) break;
+
+        const float remaining = 1.0f - contact.time;
+        if(contact.normal_x) {
+            ret[contact.normal_x < 0 ? RightCollision : LeftCollision] = true;
+            dx = 0.0f;
+            dy *= remaining;
+        } else {
+            ret[contact.normal_y < 0 ? BottomCollision : TopCollision] = true;
+            dx *= remaining;
+            dy = 0.0f;
+        }
+    }
+
+    if((p.x() + entity_width) > (m_width * m_block_width)) ret[EndWorld] = true;
+    if((p.y() + entity_height) > (m_height * m_block_height)) ret[FellOffWorld] = true;
+
+    *new_position = Vector<float>(p.x(), p.y(), new_position->z());
+    return ret;
+}
+
+
+World::Contact World::sweep(const Vector<float>& position, float dx, float dy, int width, int height) const
+{
+    ENTER_FUNCTION(World::sweep);
+
+    Contact contact;
+    if(dx == 0.0f && dy == 0.0f) return contact;
+
+    // the blocks the box passes over
+    const float block_width = static_cast<float>(m_block_width);
+    const float block_height = static_cast<float>(m_block_height);
+
+    const int first_x = static_cast<int>(std::floor(std::min(position.x(), position.x() + dx) / block_width));
+    const int last_x = static_cast<int>(std::ceil((std::max(position.x(), position.x() + dx) + width) / block_width)) - 1;
+    const int first_y = static_cast<int>(std::floor(std::min(position.y(), position.y() + dy) / block_height));
+    const int last_y = static_cast<int>(std::ceil((std::max(position.y(), position.y() + dy) + height) / block_height)) - 1;
+
+    // most moves don't come anywhere near a block
+    if(!m_collision.any(first_x, first_y, last_x, last_y)) return contact;
+
+    // walk the blocks along the main axis of the motion, so we can
+    // stop as soon as the box couldn't reach the next row or column
+    // before the contact we've already found
+    if(std::fabs(dx) >= std::fabs(dy)) {
+        const int step = (dx > 0.0f) ? 1 : -1;
+        const int end = ((dx > 0.0f) ? last_x : first_x) + step;
+        for(int x=((dx > 0.0f) ? first_x : last_x); x != end; x += step) {
+            const float reach = (dx > 0.0f)
+                ? ((x * block_width) - (position.x() + width)) / dx
+                : (((x + 1) * block_width) - position.x()) / dx;
+            if(reach > contact.time) break;
+
+            for(int y=first_y; y<=last_y; ++y)
+                sweep_block(x, y, position, dx, dy, width, height, &contact);
+        }
+    } else {
+        const int step = (dy > 0.0f) ? 1 : -1;
+        const int end = ((dy > 0.0f) ? last_y : first_y) + step;
+        for(int y=((dy > 0.0f) ? first_y : last_y); y != end; y += step) {
+            const float reach = (dy > 0.0f)
+                ? ((y * block_height) - (position.y() + height)) / dy
+                : (((y + 1) * block_height) - position.y()) / dy;
+            if(reach > contact.time) break;
+
+            for(int x=m_collision.first(y, first_x, last_x); x >= 0; x=m_collision.first(y, x + 1, last_x))
+                sweep_block(x, y, position, dx, dy, width, height, &contact);
+        }
+    }
+    return contact;
+}
+
+
+World::RayHit World::raycast(const Vector<float>& origin, const Vector<float>& direction, float max_distance) const
+{
+    ENTER_FUNCTION(World::raycast);
+
+    RayHit hit;
+    hit.distance = max_distance;
+
+    const float length = std::sqrt((direction.x() * direction.x()) + (direction.y() * direction.y()));
+    if(length == 0.0f || max_distance <= 0.0f) return hit;
+
+    const float dx = direction.x() / length;
+    const float dy = direction.y() / length;
+
+    const float block_width = static_cast<float>(m_block_width);
+    const float block_height = static_cast<float>(m_block_height);
+
+    int x = static_cast<int>(std::floor(origin.x() / block_width));
+    int y = static_cast<int>(std::floor(origin.y() / block_height));
+
+    // most rays don't come anywhere near a block
+    const int end_x = static_cast<int>(std::floor((origin.x() + (dx * max_distance)) / block_width));
+    const int end_y = static_cast<int>(std::floor((origin.y() + (dy * max_distance)) / block_height));
+    if(!m_collision.any(std::min(x, end_x), std::min(y, end_y), std::max(x, end_x), std::max(y, end_y))) return hit;
+
+    if(m_collision.test(x, y)) {
+        hit.distance = 0.0f;
+        hit.x = x; hit.y = y;
+        return hit;
+    }
+
+    // how far along the ray the next column and row boundaries are, and how far apart they are
+    const int step_x = (dx > 0.0f) ? 1 : -1;
+    const int step_y = (dy > 0.0f) ? 1 : -1;
+    const float delta_x = (dx != 0.0f) ? block_width / std::fabs(dx) : FLT_MAX;
+    const float delta_y = (dy != 0.0f) ? block_height / std::fabs(dy) : FLT_MAX;
+    float next_x = (dx != 0.0f) ? (((x + (dx > 0.0f ? 1 : 0)) * block_width) - origin.x()) / dx : FLT_MAX;
+    float next_y = (dy != 0.0f) ? (((y + (dy > 0.0f ? 1 : 0)) * block_height) - origin.y()) / dy : FLT_MAX;
+
+    while(true) {
+        float distance;
+        if(next_x < next_y) {
+            distance = next_x;
+            x += step_x;
+            next_x += delta_x;
+            hit.normal_x = -step_x;
+            hit.normal_y = 0;
+        } else {
+            distance = next_y;
+            y += step_y;
+            next_y += delta_y;
+            hit.normal_x = 0;
+            hit.normal_y = -step_y;
+        }
+        if(distance > max_distance) break;
+
+        if(m_collision.test(x, y)) {
+            hit.distance = distance;
+            hit.x = x; hit.y = y;
+            return hit;
+        }
+    }
+
+    hit.normal_x = hit.normal_y = 0;
+    return hit;
+}
+
+
+int World::overlap(const Vector<float>& position, int width, int height, Vector<int>* const blocks, int max_blocks) const
+{
+    ENTER_FUNCTION(World::overlap);
+
+    if((blocks && max_blocks <= 0) || width <= 0 || height <= 0) return 0;
+
+    const int first_x = static_cast<int>(std::floor(position.x() / m_block_width));
+    const int last_x = static_cast<int>(std::ceil((position.x() + width) / m_block_width)) - 1;
+    const int first_y = static_cast<int>(std::floor(position.y() / m_block_height));
+    const int last_y = static_cast<int>(std::ceil((position.y() + height) / m_block_height)) - 1;
+    if(!m_collision.any(first_x, first_y, last_x, last_y)) return 0;
+
+    int count = 0;
+
+    // counting is a popcount per row, none of the blocks have to be walked
+    if(!blocks) {
+        for(int y=first_y; y<=last_y; ++y)
+            count += m_collision.count(y, first_x, last_x);
+        return count;
+    }
+
+    for(int y=first_y; y<=last_y; ++y) {
+        for(int x=m_collision.first(y, first_x, last_x); x >= 0; x=m_collision.first(y, x + 1, last_x)) {
+            blocks[count++] = Vector<int>(x, y, 0);
+            if(count == max_blocks) return count;
+        }
+    }
+    return count;
+}
+
+
+bool World::line_of_sight(const Vector<float>& a, const Vector<float>& b) const
+{
+    ENTER_FUNCTION(World::line_of_sight);
+
+    const Vector<float> direction(b.x() - a.x(), b.y() - a.y(), 0.0f);
+    const float distance = std::sqrt((direction.x() * direction.x()) + (direction.y() * direction.y()));
+    if(distance == 0.0f) return !m_collision.test(static_cast<int>(std::floor(a.x() / m_block_width)), static_cast<int>(std::floor(a.y() / m_block_height)));
+
+    return !raycast(a, direction, distance).hit();
+}
+
+
+void World::benchmark_collision(std::ostream& out, int queries) const
+{
+    ENTER_FUNCTION(World::benchmark_collision);
+
+    if(queries <= 0) return;
+
+    // Skratch sized boxes moving up to two blocks each way, kept inside the world
+    const int entity_width = m_block_width;
+    const int entity_height = m_block_height * 2;
+    const int max_x = pixel_width() - entity_width;
+    const int max_y = pixel_height() - entity_height;
+    if(max_x <= 0 || max_y <= 0) return;
+
+    std::vector<Vector<float> > from, to;
+    from.reserve(queries);
+    to.reserve(queries);
+
+    unsigned long seed = 12345;
+    for(int i=0; i<queries; ++i) {
+        seed = (seed * 1103515245UL) + 12345UL;
+        const float x = static_cast<float>((seed >> 8) % max_x);
+        seed = (seed * 1103515245UL) + 12345UL;
+        const float y = static_cast<float>((seed >> 8) % max_y);
+        seed = (seed * 1103515245UL) + 12345UL;
+        const float dx = static_cast<float>(static_cast<int>((seed >> 8) % (m_block_width * 4)) - (m_block_width * 2));
+        seed = (seed * 1103515245UL) + 12345UL;
+        const float dy = static_cast<float>(static_cast<int>((seed >> 8) % (m_block_height * 4)) - (m_block_height * 2));
+
+        from.push_back(Vector<float>(x, y, 0.0f));
+        to.push_back(Vector<float>(std::max(0.0f, std::min(x + dx, static_cast<float>(max_x))),
+            std::max(0.0f, std::min(y + dy, static_cast<float>(max_y))), 0.0f));
+    }
+
+    unsigned long discrete_hits = 0;
+    Uint32 start = SDL_GetTicks();
+    for(int i=0; i<queries; ++i) {
+        Vector<float> p(to[i]);
+        discrete_hits += discrete_collision(from[i], &p, entity_width, entity_height).count();
+    }
+    const Uint32 discrete_ms = SDL_GetTicks() - start;
+
+    unsigned long swept_hits = 0;
+    start = SDL_GetTicks();
+    for(int i=0; i<queries; ++i) {
+        Vector<float> p(to[i]);
+        swept_hits += collision(from[i], &p, entity_width, entity_height).count();
+    }
+    const Uint32 swept_ms = SDL_GetTicks() - start;
+
+    out << "Collision benchmark (" << queries << " queries):" << std::endl
+        << "discrete: " << discrete_ms << " ms, " << (discrete_ms * 1000.0f) / queries << " us per query, " << discrete_hits << " contacts" << std::endl
+        << "swept: " << swept_ms << " ms, " << (swept_ms * 1000.0f) / queries << " us per query, " << swept_hits << " contacts" << std::endl;
+}
+
+
+std::bitset<World::CollisionSize> World::discrete_collision(const Vector<float>& old_position, Vector<float>* const new_position, int entity_width, int entity_height) const
 {
 /*
 A HUGE thanks goes out to MSW at the Gamedev (http://www.gamedev.net) forums
@@ -230,10 +599,11 @@ for helping me understand this approach to world collision detection.
 */
 
 /*
-FIXME: follow the path rather than just going straight to where we're at
+NOTE: this goes straight to where we're at without following the path,
+so it's only kept around to benchmark collision() against
 */
 
-    ENTER_FUNCTION(World::collision);
+    ENTER_FUNCTION(World::discrete_collision);
 
     std::bitset<CollisionSize> ret;
 
@@ -260,10 +630,10 @@ FIXME: follow the path rather than just going straight to where we're at
         bottom_tile_top = bottom_box * m_block_height;
         top_tile_bottom = (top_box * m_block_height) + m_block_height;
 
-        if(m_blocks[calc_grid_location(x, bottom_box, m_width)].type == MapBlock::Collidable) {
+        if(collidable(x, bottom_box)) {
             np.set_y(bottom_tile_top - entity_height);
             ret[BottomCollision] = true;
-        } else if(m_blocks[calc_grid_location(x, top_box, m_width)].type == MapBlock::Collidable) {
+        } else if(collidable(x, top_box)) {
             np.set_y(top_tile_bottom);
             ret[TopCollision] = true;
         }
@@ -282,10 +652,10 @@ FIXME: follow the path rather than just going straight to where we're at
         right_tile_left = (right_box * m_block_width);
         left_tile_right = (left_box * m_block_width) + m_block_width;
 
-        if(m_blocks[calc_grid_location(left_box, y, m_width)].type == MapBlock::Collidable) {
+        if(collidable(left_box, y)) {
             np.set_x(left_tile_right);
             ret[LeftCollision] = true;
-        } else if(m_blocks[calc_grid_location(right_box, y, m_width)].type == MapBlock::Collidable) {
+        } else if(collidable(right_box, y)) {
             np.set_x(right_tile_left - entity_width);
             ret[RightCollision] = true;
         }
@@ -299,176 +669,648 @@ FIXME: follow the path rather than just going straight to where we're at
 }
 
 
-bool World::load_collision_map(std::string path)
+void World::sweep_block(int x, int y, const Vector<float>& position, float dx, float dy, int width, int height, Contact* const contact) const
 {
-    ENTER_FUNCTION(World::load_collision_map);
-
-    path += "collision.map";
-    std::ifstream infile(path.c_str());
-    if(!infile) {
-        std::cerr << "Couldn't open collision map - " << path << std::endl;
-        return false;
+    if(!collidable(x, y)) return;
+
+    const float left = static_cast<float>(x * m_block_width);
+    const float top = static_cast<float>(y * m_block_height);
+    const float right = left + m_block_width;
+    const float bottom = top + m_block_height;
+
+    // when the box starts and stops overlapping the block on each axis
+    float entry_x = -FLT_MAX, exit_x = FLT_MAX;
+    if(dx > 0.0f) {
+        entry_x = contact_time(left - (position.x() + width), dx);
+        exit_x = (right - position.x()) / dx;
+    } else if(dx < 0.0f) {
+        entry_x = contact_time(position.x() - right, -dx);
+        exit_x = (left - (position.x() + width)) / dx;
+    } else if((position.x() + width) <= left + CONTACT_TOLERANCE || position.x() >= right - CONTACT_TOLERANCE) return;
+
+    float entry_y = -FLT_MAX, exit_y = FLT_MAX;
+    if(dy > 0.0f) {
+        entry_y = contact_time(top - (position.y() + height), dy);
+        exit_y = (bottom - position.y()) / dy;
+    } else if(dy < 0.0f) {
+        entry_y = contact_time(position.y() - bottom, -dy);
+        exit_y = (top - (position.y() + height)) / dy;
+    } else if((position.y() + height) <= top + CONTACT_TOLERANCE || position.y() >= bottom - CONTACT_TOLERANCE) return;
+
+    // boxes that start out overlapping the block are left alone
+    const float entry = std::max(entry_x, entry_y);
+    const float exit = std::min(exit_x, exit_y);
+    if(entry < 0.0f || entry >= exit || entry >= contact->time) return;
+
+    contact->time = entry;
+    if(entry_x > entry_y) {
+        contact->normal_x = (dx > 0.0f) ? -1 : 1;
+        contact->normal_y = 0;
+    } else {
+        contact->normal_x = 0;
+        contact->normal_y = (dy > 0.0f) ? -1 : 1;
     }
+}
 
-    char width, height;
-    infile.get(width);
-    infile.get(height);
 
-    if(width < m_blocks_wide) {
-        std::cerr << "World is not wide enough" << std::endl;
-        infile.clear(); infile.close();
-        return false;
-    }
-    if(height < m_blocks_high) {
-        std::cerr << "World is not high enough" << std::endl;
-        infile.clear(); infile.close();
-        return false;
+std::bitset<World::CollisionSize> World::depenetrate(Vector<float>* const position, int width, int height) const
+{
+    ENTER_FUNCTION(World::depenetrate);
+
+    std::bitset<CollisionSize> ret;
+
+    const float block_width = static_cast<float>(m_block_width);
+    const float block_height = static_cast<float>(m_block_height);
+
+    for(int i=0; i<MaxDepenetrationSteps; ++i) {
+        // only blocks the box is actually inside of, touching doesn't count
+        const int first_x = static_cast<int>(std::floor((position->x() + CONTACT_TOLERANCE) / block_width));
+        const int last_x = static_cast<int>(std::ceil((position->x() + width - CONTACT_TOLERANCE) / block_width)) - 1;
+        const int first_y = static_cast<int>(std::floor((position->y() + CONTACT_TOLERANCE) / block_height));
+        const int last_y = static_cast<int>(std::ceil((position->y() + height - CONTACT_TOLERANCE) / block_height)) - 1;
+        if(!m_collision.any(first_x, first_y, last_x, last_y)) break;
+
+        // the shallowest way out of any one block, but never into the block next to it
+        float depth = FLT_MAX;
+        int normal_x = 0, normal_y = 0;
+        for(int y=first_y; y<=last_y; ++y) {
+            for(int x=first_x; x<=last_x; ++x) {
+                if(!collidable(x, y)) continue;
+
+                const float left = x * block_width;
+                const float top = y * block_height;
+
+                const float out_left = (position->x() + width) - left;
+                const float out_right = (left + block_width) - position->x();
+                const float out_top = (position->y() + height) - top;
+                const float out_bottom = (top + block_height) - position->y();
+
+                if(!collidable(x - 1, y) && out_left < depth) { depth = out_left; normal_x = -1; normal_y = 0; }
+                if(!collidable(x + 1, y) && out_right < depth) { depth = out_right; normal_x = 1; normal_y = 0; }
+                if(!collidable(x, y - 1) && out_top < depth) { depth = out_top; normal_x = 0; normal_y = -1; }
+                if(!collidable(x, y + 1) && out_bottom < depth) { depth = out_bottom; normal_x = 0; normal_y = 1; }
+            }
+        }
+
+        // buried, there's no open side to push it out of
+        if(FLT_MAX == depth) break;
+
+        position->add_x(normal_x * depth);
+        position->add_y(normal_y * depth);
+        if(normal_x) ret[normal_x < 0 ? RightCollision : LeftCollision] = true;
+        else ret[normal_y < 0 ? BottomCollision : TopCollision] = true;
     }
+    return ret;
+}
 
-    m_width = width;
-    m_height = height;
 
-    m_position = Vector<int>(0, (m_height * m_block_height) - Video::window_height(), 0);
+bool World::collidable(int x, int y) const
+{
+    return m_collision.test(x, y);
+}
 
-    char c=0;
-    infile.get(c);
-    if(c != '\n') {
-        std::cerr << "Invalid collision map" << std::endl;
-        infile.clear(); infile.close();
-        return false;
+
+int World::surface(int x, int y) const
+{
+    int id = m_level.tile(x, y);
+    if(!m_edits.empty()) {
+        const std::map<int, int>::const_iterator it = m_edits.find((y * m_width) + x);
+        if(it != m_edits.end()) id = it->second;
     }
+    return Tileset::surface(id);
+}
 
-    m_blocks.reserve(m_width * m_height);
 
-    for(int y=0; y<m_height; ++y) {
-        for(int x=0; x<m_width; ++x) {
-            if(infile.eof()) {
-                std::cerr << "Invalid collision map dimensions" << std::endl;
-                infile.clear(); infile.close();
-                return false;
+void World::render_background() const
+{
+    ENTER_FUNCTION(World::render_background);
+
+    // how far the window is from the bottom of the world
+    const int bottom = pixel_height() - Video::window_height();
+
+    for(std::vector<ParallaxLayer>::const_iterator it = m_layers.begin(); it != m_layers.end(); ++it) {
+        const SDL_Surface* const image = Video::at(it->index);
+        if(!image || image->w <= 0 || image->h <= 0) continue;
+
+        // where the window is on the layer, wrapped to the image
+        const int scroll_x = static_cast<int>(m_position.x() * it->x_factor);
+        const int scroll_y = static_cast<int>((m_position.y() - bottom) * it->y_factor) + (image->h - Video::window_height());
+        const int offset_x = ((scroll_x % image->w) + image->w) % image->w;
+        const int offset_y = ((scroll_y % image->h) + image->h) % image->h;
+
+        // the blits clip themselves to the window
+        for(int y=-offset_y; y<Video::window_height(); y+=image->h) {
+            for(int x=-offset_x; x<Video::window_width(); x+=image->w) {
+                SDL_Rect pos;
+                pos.x = x; pos.y = y;
+                Video::render_surface(it->index, NULL, &pos);
             }
+        }
+    }
+}
+
+
+void World::draw_tiles(int x, int y, int width, int height, SDL_Surface* const target, int target_x, int target_y)
+{
+    ENTER_FUNCTION(World::draw_tiles);
+
+    // the chunks are at least as big as the window, so this is four blits at most
+    const int chunk_width = m_tile_cache.chunk_width();
+    const int chunk_height = m_tile_cache.chunk_height();
+    const int first_column = std::max(0, x / chunk_width);
+    const int first_row = std::max(0, y / chunk_height);
+    const int last_column = std::min(m_tile_cache.columns() - 1, (x + width - 1) / chunk_width);
+    const int last_row = std::min(m_tile_cache.rows() - 1, (y + height - 1) / chunk_height);
+
+    for(int row=first_row; row<=last_row; ++row) {
+        for(int column=first_column; column<=last_column; ++column) {
+            const int chunk = (row * m_tile_cache.columns()) + column;
+
+            // the chunks are baked ahead of time, this only catches the ones an edit threw out
+            SDL_Surface* surface = m_tile_cache.find(chunk);
+            if(!surface) {
+                surface = m_tile_cache.allocate(chunk);
+                if(!surface) continue;
+                bake_chunk(chunk, surface);
+            }
+
+            // the part of the chunk inside the area
+            const int left = std::max(x, column * chunk_width);
+            const int top = std::max(y, row * chunk_height);
+            const int right = std::min(x + width, (column + 1) * chunk_width);
+            const int bottom = std::min(y + height, (row + 1) * chunk_height);
+
+            SDL_Rect src;
+            src.x = left - (column * chunk_width);
+            src.y = top - (row * chunk_height);
+            src.w = right - left;
+            src.h = bottom - top;
 
-            infile.get(c);
-            if(c - '0') m_blocks.push_back(MapBlock(MapBlock::Collidable, -1));
-            else m_blocks.push_back(MapBlock(MapBlock::NotCollidable, -1));
+            SDL_Rect pos;
+            pos.x = target_x + (left - x);
+            pos.y = target_y + (top - y);
+
+            if(target) SDL_BlitSurface(surface, &src, target, &pos);
+            else Video::render_surface(surface, &src, &pos);
         }
+    }
+}
+
+
+bool World::render_tile_layer()
+{
+    ENTER_FUNCTION(World::render_tile_layer);
+
+    const int width = Video::window_width();
+    const int height = Video::window_height();
+
+    if(!m_tile_layer || m_tile_layer->w != width || m_tile_layer->h != height) {
+        if(m_tile_layer) SDL_FreeSurface(m_tile_layer);
+        m_tile_layer = Video::create_surface(width, height);
+        if(!m_tile_layer) return false;
 
-        infile.get(c);
-        if(c != '\n') {
-            std::cerr << "Invalid collision map" << std::endl;
-            infile.clear(); infile.close();
-            return false;
+        SDL_SetColorKey(m_tile_layer, SDL_SRCCOLORKEY, SDL_MapRGB(m_tile_layer->format, 0, 255, 0));
+        m_tile_layer_valid = false;
+    }
+
+    const Uint32 key = SDL_MapRGB(m_tile_layer->format, 0, 255, 0);
+    const int dx = m_position.x() - m_tile_layer_position.x();
+    const int dy = m_position.y() - m_tile_layer_position.y();
+
+    if(!m_tile_layer_valid || std::abs(dx) >= width || std::abs(dy) >= height) {
+        SDL_FillRect(m_tile_layer, NULL, key);
+        draw_tiles(m_position.x(), m_position.y(), width, height, m_tile_layer, 0, 0);
+    } else if(dx || dy) {
+        shift_surface(m_tile_layer, -dx, -dy);
+
+        // only the strips that scrolled into view are drawn
+        SDL_Rect strip;
+        if(dx) {
+            strip.x = (dx > 0) ? width - dx : 0;
+            strip.y = 0;
+            strip.w = std::abs(dx);
+            strip.h = height;
+            SDL_FillRect(m_tile_layer, &strip, key);
+            draw_tiles(m_position.x() + strip.x, m_position.y(), strip.w, strip.h, m_tile_layer, strip.x, 0);
+        }
+        if(dy) {
+            strip.x = 0;
+            strip.y = (dy > 0) ? height - dy : 0;
+            strip.w = width;
+            strip.h = std::abs(dy);
+            SDL_FillRect(m_tile_layer, &strip, key);
+            draw_tiles(m_position.x(), m_position.y() + strip.y, strip.w, strip.h, m_tile_layer, 0, strip.y);
         }
     }
-    infile.clear(); infile.close();
+
+    m_tile_layer_position = m_position;
+    m_tile_layer_valid = true;
+
+    SDL_Rect pos;
+    pos.x = 0; pos.y = 0;
+    Video::render_surface(m_tile_layer, NULL, &pos);
     return true;
 }
 
 
-bool World::load_texture_map(std::string path)
+void World::bake_chunk(int chunk, SDL_Surface* const surface) const
 {
-    ENTER_FUNCTION(World::load_texture_map);
-
-    path += "texture.map";
-    std::ifstream infile(path.c_str());
-    if(!infile) {
-        std::cerr << "Couldn't open texture map - " << path << std::endl;
-        return false;
+    ENTER_FUNCTION(World::bake_chunk);
+
+    const int tiles_wide = m_tile_cache.chunk_width() / m_block_width;
+    const int tiles_high = m_tile_cache.chunk_height() / m_block_height;
+    const int first_x = (chunk % m_tile_cache.columns()) * tiles_wide;
+    const int first_y = (chunk / m_tile_cache.columns()) * tiles_high;
+    const int last_x = std::min(m_width, first_x + tiles_wide);
+    const int last_y = std::min(m_height, first_y + tiles_high);
+
+    for(int y=first_y; y<last_y; ++y) {
+        for(int x=first_x; x<last_x; ++x) {
+            const int surface_index = this->surface(x, y);
+            if(surface_index < 0) continue;
+
+            SDL_Rect pos;
+            pos.x = (x - first_x) * m_block_width;
+            pos.y = (y - first_y) * m_block_height;
+            SDL_BlitSurface(Video::at(surface_index), NULL, surface, &pos);
+        }
     }
+}
+
 
-    char c=0;
-    for(int y=0; y<m_height; ++y) {
-        for(int x=0; x<m_width; ++x) {
-            if(infile.eof()) {
-                std::cerr << "Invalid texture map dimensions" << std::endl;
-                infile.clear(); infile.close();
-                return false;
+int World::bake_chunks(int x, int y, int width, int height, int max_bakes, bool streamed)
+{
+    ENTER_FUNCTION(World::bake_chunks);
+
+    const int chunk_width = m_tile_cache.chunk_width();
+    const int chunk_height = m_tile_cache.chunk_height();
+    if(chunk_width <= 0 || chunk_height <= 0) return 0;
+
+    const int first_column = std::max(0, x / chunk_width);
+    const int first_row = std::max(0, y / chunk_height);
+    const int last_column = std::min(m_tile_cache.columns() - 1, (x + width - 1) / chunk_width);
+    const int last_row = std::min(m_tile_cache.rows() - 1, (y + height - 1) / chunk_height);
+
+    int baked = 0;
+    for(int row=first_row; row<=last_row; ++row) {
+        for(int column=first_column; column<=last_column; ++column) {
+            if(max_bakes >= 0 && baked >= max_bakes) return baked;
+
+            const int chunk = (row * m_tile_cache.columns()) + column;
+            if(m_tile_cache.find(chunk)) continue;
+
+            // a level chunk that isn't paged in would stall the frame on the disk
+            if(streamed) {
+                const int size = m_level.chunk_size();
+                const int last_x = std::min(m_width, ((column + 1) * chunk_width) / m_block_width) - 1;
+                const int last_y = std::min(m_height, ((row + 1) * chunk_height) / m_block_height) - 1;
+
+                bool ready = true;
+                for(int ly=((row * chunk_height) / m_block_height) / size; ly<=last_y / size && ready; ++ly) {
+                    for(int lx=((column * chunk_width) / m_block_width) / size; lx<=last_x / size && ready; ++lx)
+                        ready = m_level.ready((ly * m_level.chunks_wide()) + lx);
+                }
+                if(!ready) continue;
             }
 
-            const int location = calc_grid_location(x, y, m_width);
+            SDL_Surface* const surface = m_tile_cache.allocate(chunk);
+            if(!surface) return baked;
 
-            infile.get(c);
-            if(c - '0') {
-                char filename[256];
-                snprintf(filename, 256,  DATADIR "/levels/blocks/block%02d.tga", c - '0');
-                m_blocks[location].surface_index = Video::scale_surface(Video::load_image(filename), m_block_width, m_block_height);
-            }
+            bake_chunk(chunk, surface);
+            ++baked;
+        }
+    }
+    return baked;
+}
+
+
+void World::build_collision()
+{
+    ENTER_FUNCTION(World::build_collision);
+
+    // the collision plane is laid out like the grid, so it's read front to back once
+    // and none of the chunks are touched
+    m_collision.resize(m_width, m_height);
+    for(int y=0; y<m_height; ++y)
+        m_collision.set_row(y, m_level.collision_row(y));
+    m_collision.update_summary();
+
+    // the grid has its own copy now
+    m_level.discard_collision();
+}
+
+
+void World::stream_chunks()
+{
+    ENTER_FUNCTION(World::stream_chunks);
+
+    // the window in chunks, with the margin around it
+    const int chunk_width = m_level.chunk_size() * m_block_width;
+    const int chunk_height = m_level.chunk_size() * m_block_height;
+    int left = m_position.x() / chunk_width - ChunkMargin;
+    int top = m_position.y() / chunk_height - ChunkMargin;
+    int right = (m_position.x() + Video::window_width()) / chunk_width + ChunkMargin;
+    int bottom = (m_position.y() + Video::window_height()) / chunk_height + ChunkMargin;
+
+    // anything outside of that (and a chunk more to keep from thrashing) can be paged out again
+    for(int i=static_cast<int>(m_prefetched.size())-1; i>=0; --i) {
+        const int c = m_prefetched[i];
+        const int cx = c % m_level.chunks_wide(), cy = c / m_level.chunks_wide();
+        if(cx < left - 1 || cx > right + 1 || cy < top - 1 || cy > bottom + 1) {
+            m_level.release(c);
+            m_prefetched[i] = m_prefetched.back();
+            m_prefetched.pop_back();
         }
+    }
 
-        infile.get(c);
-        if(c != '\n') {
-            std::cerr << "Invalid texture map" << std::endl;
-            infile.clear(); infile.close();
-            return false;
+    // stretch the window toward where the scrolling will be in a bit
+    const int ahead_x = m_scroll_velocity.x() * PrefetchFrames;
+    const int ahead_y = m_scroll_velocity.y() * PrefetchFrames;
+    if(ahead_x < 0) left += ahead_x / chunk_width - 1;
+    else if(ahead_x > 0) right += ahead_x / chunk_width + 1;
+    if(ahead_y < 0) top += ahead_y / chunk_height - 1;
+    else if(ahead_y > 0) bottom += ahead_y / chunk_height + 1;
+
+    left = std::max(0, left);
+    top = std::max(0, top);
+    right = std::min(m_level.chunks_wide() - 1, right);
+    bottom = std::min(m_level.chunks_high() - 1, bottom);
+
+    for(int y=top; y<=bottom; ++y) {
+        for(int x=left; x<=right; ++x) {
+            const int c = y * m_level.chunks_wide() + x;
+            if(std::find(m_prefetched.begin(), m_prefetched.end(), c) == m_prefetched.end()) {
+                m_level.request(c);
+                m_prefetched.push_back(c);
+            }
         }
     }
-    infile.clear(); infile.close();
-    return true;
+
+    // pre-render the tiles the scrolling is headed into, but no more than a chunk past the window
+    // so the cache can hold them along with the window's, and only a few a frame so it never hitches
+    const int render_ahead_x = std::max(-m_tile_cache.chunk_width(), std::min(m_tile_cache.chunk_width(), ahead_x));
+    const int render_ahead_y = std::max(-m_tile_cache.chunk_height(), std::min(m_tile_cache.chunk_height(), ahead_y));
+    bake_chunks(m_position.x() + std::min(0, render_ahead_x), m_position.y() + std::min(0, render_ahead_y),
+        Video::window_width() + std::abs(render_ahead_x), Video::window_height() + std::abs(render_ahead_y),
+        ChunkBakesPerFrame, true);
 }
 
 
-bool World::load_entity_map(std::string path, const VideoState& video_state)
+bool World::load_level(std::string path)
 {
-    ENTER_FUNCTION(World::load_entity_map);
+    ENTER_FUNCTION(World::load_level);
 
-    path += "entity.map";
-    std::ifstream infile(path.c_str());
-    if(!infile) {
-        std::cerr << "Couldn't open entity map - " << path << std::endl;
+    path += "level.bin";
+    if(!m_level.open(path)) {
+        std::cerr << "Couldn't load level - " << path << " (run editor -compile in the level directory)" << std::endl;
         return false;
     }
 
-    char c=0;
-    for(int y=0; y<m_height; ++y) {
-        for(int x=0; x<m_width; ++x) {
-            if(infile.eof()) {
-                std::cerr << "Invalid entity map dimensions" << std::endl;
-                infile.clear(); infile.close();
-                return false;
-            }
+    if(m_level.width() < m_blocks_wide || m_level.height() < m_blocks_high) {
+        std::cerr << "World is not big enough for the window" << std::endl;
+        m_level.close();
+        return false;
+    }
 
-            infile.get(c);
-            switch(c)
-            {
-            case '0': break;
-            case 'B':
-                new Blaster();
-                Entity::back()->load_media(video_state);
-                Entity::back()->set_position(Vector<float>(static_cast<float>(x * m_block_width), static_cast<float>(y * m_block_height), 0.0f));
-                break;
-            case 'S':
-                new BlueCollarSuit();
-                Entity::back()->load_media(video_state);
-                Entity::back()->set_position(Vector<float>(static_cast<float>(x * m_block_width), static_cast<float>(y * m_block_height), 0.0f));
-                break;
-            default:
-                std::cerr << "WARNING: Unknown entity, " << c << ", found in entity map" << std::endl;
-            }
-        }
+    m_width = m_level.width();
+    m_height = m_level.height();
+    m_position = Vector<int>(0, (m_height * m_block_height) - Video::window_height(), 0);
 
-        infile.get(c);
-        if(c != '\n') {
-            std::cerr << "Invalid texture map" << std::endl;
-            infile.clear(); infile.close();
-            return false;
+    m_edits.clear();
+    build_collision();
+    m_tile_layer_valid = false;
+
+    // the chunks are drawn when the level starts and as the scrolling heads toward them
+    const int chunk_width = std::max(static_cast<int>(RenderChunkSize), Video::window_width());
+    const int chunk_height = std::max(static_cast<int>(RenderChunkSize), Video::window_height());
+    m_tile_cache.reset(((chunk_width + m_block_width - 1) / m_block_width) * m_block_width,
+        ((chunk_height + m_block_height - 1) / m_block_height) * m_block_height,
+        pixel_width(), pixel_height(), TileCacheSize);
+
+    m_spawns.clear();
+    for(int i=0; i<m_level.spawn_count(); ++i) {
+        char type;
+        int x, y;
+        m_level.spawn(i, &type, &x, &y);
+
+        switch(type)
+        {
+        case 'B':
+            m_spawns.push_back(Spawn(Spawn::BlasterSpawn, x, y));
+            break;
+        case 'S':
+            m_spawns.push_back(Spawn(Spawn::BlueCollarSuitSpawn, x, y));
+            break;
+        default:
+            std::cerr << "WARNING: Unknown entity, " << type << ", found in spawn table" << std::endl;
         }
     }
-    infile.clear(); infile.close();
+
+    // the chunks aren't asked for until finish(), on the thread that scrolls
+    m_prefetched.clear();
+    m_scroll_velocity = Vector<int>();
     return true;
 }
 
 
-void World::load_background(std::string path)
+void World::read_background(std::string path, const VideoState& video_state, bool decode)
+{
+    ENTER_FUNCTION(World::read_background);
+
+    m_pending_layers.clear();
+
+    std::ifstream infile((path + "background.layers").c_str());
+    if(!infile) {
+        // file must exist
+        struct stat buf;
+        if(!stat((path + "background.tga").c_str(), &buf))
+            m_pending_layers.push_back(PendingLayer(path + "background.tga", 0.5f, 0.5f));
+    } else {
+        /* # image  x_factor  y_factor
+           clouds   0.25      0.25 */
+        std::string line;
+        while(std::getline(infile, line)) {
+            if(line.empty() || '#' == line[0]) continue;
+
+            std::istringstream fields(line);
+            std::string image;
+            float x_factor, y_factor;
+            if(!(fields >> image >> x_factor >> y_factor)) {
+                std::cerr << "Invalid background layer in " << path << "background.layers: " << line << std::endl;
+                continue;
+            }
+            m_pending_layers.push_back(PendingLayer(path + image + ".tga", x_factor, y_factor));
+        }
+        infile.clear(); infile.close();
+    }
+
+    if(!decode) return;
+
+    for(std::vector<PendingLayer>::iterator it = m_pending_layers.begin(); it != m_pending_layers.end(); ++it) {
+        SDL_Surface* const image = Video::decode_image(it->filename);
+        if(!image) continue;
+
+        it->image = Video::scale_copy(image, std::max(1, static_cast<int>(image->w * video_state.width_scale)),
+            std::max(1, static_cast<int>(image->h * video_state.height_scale)));
+        SDL_FreeSurface(image);
+    }
+}
+
+
+void World::load_background(const VideoState& video_state)
 {
     ENTER_FUNCTION(World::load_background);
 
-    path += "background.tga";
+    m_layers.clear();
+    for(std::vector<PendingLayer>::const_iterator it = m_pending_layers.begin(); it != m_pending_layers.end(); ++it) {
+        const int index = load_layer_image(it->filename, video_state, it->image);
+        if(index >= 0) m_layers.push_back(ParallaxLayer(index, it->x_factor, it->y_factor));
+    }
+    m_pending_layers.clear();
+}
 
-    // file must exist
-    struct stat buf;
-    if(stat(path.c_str(), &buf)) return;
 
-    m_background_index = Video::scale_surface(Video::load_image(path), Video::window_width(), m_height * m_block_height);
+int World::load_layer_image(const std::string& filename, const VideoState& video_state, SDL_Surface* const image) const
+{
+    ENTER_FUNCTION(World::load_layer_image);
+
+    // the layers outlive the world, so a reloaded level doesn't load or scale them again
+    static std::map<std::string, int> layer_images;
+
+    std::ostringstream name;
+    name << filename << "@" << video_state.width_scale << "x" << video_state.height_scale;
+
+    std::map<std::string, int>::const_iterator it = layer_images.find(name.str());
+    if(it != layer_images.end()) {
+        if(image) SDL_FreeSurface(image);
+        return it->second;
+    }
+
+    int scaled = -1;
+    if(image) {
+        SDL_Surface* const surface = SDL_DisplayFormat(image);
+        SDL_FreeSurface(image);
+        if(surface) scaled = Video::push_back(surface, name.str());
+    } else {
+        const int index = Video::load_image(filename);
+        const SDL_Surface* const original = Video::at(index);
+        if(!original) return -1;
+
+        // the unscaled image isn't needed once the scaled copy is made
+        scaled = Video::scale_surface(index, std::max(1, static_cast<int>(original->w * video_state.width_scale)),
+            std::max(1, static_cast<int>(original->h * video_state.height_scale)), name.str());
+        Video::unload_surface(index);
+    }
+
+    if(scaled >= 0) layer_images[name.str()] = scaled;
+    return scaled;
+}
+
+
+void World::load_navigation(const std::string& name, const VideoState& video_state)
+{
+    ENTER_FUNCTION(World::load_navigation);
+
+    m_navigation.clear();
+    m_navigation_cache.clear();
+    m_navigation_unsaved = false;
+
+    bool suits = false;
+    for(std::vector<Spawn>::const_iterator it = m_spawns.begin(); it != m_spawns.end(); ++it)
+        if(Spawn::BlueCollarSuitSpawn == it->type) suits = true;
+    if(!suits) return;
+
+    // the cached graph is only good for this collision map, block size and suit
+    // (gravity is scaled by mass, and a suit's mass is 1), so every block size gets its own
+    const NavGraph::Mover mover(BlueCollarSuit::navigation_mover(video_state));
+    const std::string cache_dir(get_cache_dir());
+    if(!cache_dir.empty()) {
+        std::ostringstream cache;
+        cache << cache_dir << "levels/" << name << "/level-" << m_block_width << "x" << m_block_height << ".nav";
+        m_navigation_cache = cache.str();
+
+        if(m_navigation.load(m_navigation_cache, m_collision, m_block_width, m_block_height, mover, GRAVITY)) return;
+    }
+
+    // this can be on the preloader thread, so finish() saves it
+    m_navigation.build(m_collision, m_block_width, m_block_height, mover, GRAVITY);
+    m_navigation_unsaved = !m_navigation_cache.empty();
+}
+
+
+void World::save_navigation()
+{
+    ENTER_FUNCTION(World::save_navigation);
+
+    if(!m_navigation_unsaved) return;
+    m_navigation_unsaved = false;
+
+    // the data directory can be read only, so the graph goes in the user's cache instead
+    create_path(get_path(m_navigation_cache), 0755);
+    if(!m_navigation.save(m_navigation_cache))
+        std::cerr << "WARNING: Couldn't save navigation graph - " << m_navigation_cache << std::endl;
+}
+
+
+void World::decode_tiles()
+{
+    ENTER_FUNCTION(World::decode_tiles);
+
+    // the tileset can't be asked what's loaded from here, so every tile is decoded
+    // and finish() throws out the ones an earlier level already loaded
+    for(int i=0; i<m_level.tile_id_count(); ++i) {
+        SDL_Surface* const image = Tileset::decode(m_level.tile_id(i), m_block_width, m_block_height);
+        if(image) m_decoded_tiles.push_back(std::make_pair(m_level.tile_id(i), image));
+    }
+}
+
+
+void World::free_decoded()
+{
+    ENTER_FUNCTION(World::free_decoded);
+
+    for(std::vector<std::pair<int, SDL_Surface*> >::const_iterator it = m_decoded_tiles.begin(); it != m_decoded_tiles.end(); ++it)
+        SDL_FreeSurface(it->second);
+    m_decoded_tiles.clear();
+
+    for(std::vector<PendingLayer>::const_iterator it = m_pending_layers.begin(); it != m_pending_layers.end(); ++it)
+        if(it->image) SDL_FreeSurface(it->image);
+    m_pending_layers.clear();
+}
+
+
+void World::spawn_entities(const VideoState& video_state) const
+{
+    ENTER_FUNCTION(World::spawn_entities);
+
+    for(std::vector<Spawn>::const_iterator it = m_spawns.begin(); it != m_spawns.end(); ++it) {
+        Entity* entity = NULL;
+        switch(it->type)
+        {
+        case Spawn::BlasterSpawn:
+            entity = new Blaster();
+            break;
+        case Spawn::BlueCollarSuitSpawn:
+            entity = new BlueCollarSuit();
+            break;
+        }
+
+        // the media comes out of the archetype and sound caches after the first load
+        entity->load_media(video_state);
+        entity->set_position(Vector<float>(static_cast<float>(it->x * m_block_width), static_cast<float>(it->y * m_block_height), 0.0f));
+    }
+
+    // the blasters sized the shot pool, and the rest of the entity stores need the same room so shooting doesn't allocate
+    Entity::reserve<Blaster::BlasterShot>(Blaster::BlasterShot::capacity());
+}
+
+
+void World::place(Skratch* const skratch) const
+{
+    ENTER_FUNCTION(World::place);
+
+/* FIXME: is this really what we want? maybe in the entity map instead? */
+    skratch->set_position(Vector<float>(0.0f, static_cast<float>(m_position.y()), skratch->position().z()));
 }
 
 
@@ -482,11 +1324,11 @@ std::ostream& operator<<(std::ostream& lhs, const World& rhs)
 {
     for(int y=0; y<rhs.m_height; ++y) {
         for(int x=0; x<rhs.m_width; ++x) {
-            const int location = calc_grid_location(x, y, rhs.m_width);
-            if(rhs.m_blocks[location].type == World::MapBlock::Collidable) lhs << "C";
+            if(rhs.m_collision.test(x, y)) lhs << "C";
             else lhs << "N";
 
-            if(rhs.m_blocks[location].surface_index >= 0) lhs << rhs.m_blocks[location].surface_index;
+            const int surface_index = rhs.surface(x, y);
+            if(surface_index >= 0) lhs << surface_index;
             else lhs << " ";
         }
         lhs << std::endl;
@@ -26,7 +26,15 @@ Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
 #include "Font.h"
 #include "Timer.h"
 #include "Skratch.h"
+#include "BlueCollarSuit.h"
 #include "World.h"
+#include "Tileset.h"
+#include "LevelPreloader.h"
+#include "Pool.h"
+#include "WorkerPool.h"
+#include "Archetype.h"
+#include "Rewind.h"
+#include "DirtyRects.h"
 #include "menu.h"
 #include "main.h"
 #include "state.h"
@@ -40,6 +48,16 @@ Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
 
 const std::string HUD_FONT_FILENAME(DATADIR "/images/hudfont.tga");
 
+// levels go in order from here, level01, level02, ...
+const std::string FIRST_LEVEL("level01");
+
+// the frame rate the game is tuned for
+const int FRAMES_PER_SECOND = 60;
+
+// about 10 seconds of play, holding r steps back through it
+const int REWIND_FRAMES = 10 * FRAMES_PER_SECOND;
+const int REWIND_KEYFRAME_INTERVAL = 30;
+
 
 /*
  *  prototypes
@@ -58,6 +76,36 @@ void event_loop(State* const state);
 
 TrigLookup g_trig_lookup;
 
+// the current level as it was loaded, for restarting without going to disk
+World::Snapshot g_level_snapshot;
+
+// the last few seconds of play
+Rewind g_rewind;
+std::vector<unsigned char> g_rewind_frame;
+
+// what changed on the window since the last frame, for -dirtyrects
+DirtyRects g_dirty_rects;
+
+// the level after the one being played
+LevelPreloader g_preloader;
+
+
+/*
+ *  structures
+ *
+ */
+
+
+/* what goes at the front of each rewind frame, the entities follow it */
+struct RewindHeader
+{
+    int world_x, world_y;
+    int lives;
+    long score;
+
+    Skratch::SavedState skratch;
+};
+
 
 /*
  *  functions
@@ -71,6 +119,8 @@ bool create_window(const VideoState& video_state, bool fullscreen)
 
     const std::string title(WINDOW_TITLE);
 
+    if(video_state.dirty_rects) Video::disable_double_buffer();
+
     if(fullscreen) {
         std::cout << "Trying fullscreen mode..." << std::endl;
         if(!Video::create_window(video_state.width, video_state.height, video_state.bpp, true, title)) {
@@ -105,6 +155,16 @@ bool game_init(State* const state, const Video& video, const Audio& audio)
 
     std::cout << std::endl << audio << std::endl;
 
+    Skratch::register_collision_handlers();
+    BlueCollarSuit::register_collision_handlers();
+
+    if(!WorkerPool::start(state->threads))
+        std::cerr << "Couldn't start the worker threads, updating entities on the main thread" << std::endl;
+
+    // the first level can be getting ready while the menu is up
+    if(!g_preloader.start(FIRST_LEVEL, state->video_state))
+        std::cerr << "Levels will be loaded as they're played" << std::endl;
+
     return true;
 }
 
@@ -128,14 +188,19 @@ void game_shutdown(State* const state)
 {
     ENTER_FUNCTION(game_shutdown);
 
+    WorkerPool::stop();
+    g_preloader.cancel();
     Entity::free_entities();
 
     if(state->world) delete state->world;
     state->world = NULL;
+    g_level_snapshot = World::Snapshot();
 
     if(state->player_state.player) delete state->player_state.player;
     state->player_state.player = NULL;
 
+    Archetype::clear();
+    Tileset::clear();
     Audio::unload_all();
     Video::unload_surfaces();
 
@@ -153,6 +218,67 @@ void game_shutdown()
 }
 
 
+void save_rewind(const std::string& filename)
+{
+    ENTER_FUNCTION(save_rewind);
+
+    if(g_rewind.size()) g_rewind.save(filename);
+}
+
+
+void reset_rewind()
+{
+    ENTER_FUNCTION(reset_rewind);
+
+    g_rewind.reset(REWIND_FRAMES, REWIND_KEYFRAME_INTERVAL);
+
+    // a removed entity has to outlive every frame that still has it listed
+    Entity::set_graveyard_frames(REWIND_FRAMES + REWIND_KEYFRAME_INTERVAL, FRAMES_PER_SECOND);
+}
+
+
+void record_frame(const State* const state)
+{
+    ENTER_FUNCTION(record_frame);
+
+    RewindHeader header;
+    header.world_x = state->world->position().x();
+    header.world_y = state->world->position().y();
+    header.lives = state->player_state.lives;
+    header.score = state->player_state.score;
+    state->player_state.player->save_state(&header.skratch);
+
+    g_rewind_frame.resize(sizeof(RewindHeader));
+    memcpy(&g_rewind_frame[0], &header, sizeof(RewindHeader));
+    Entity::save_state(&g_rewind_frame);
+
+    g_rewind.push(g_rewind_frame);
+}
+
+
+void rewind_frame(State* const state)
+{
+    ENTER_FUNCTION(rewind_frame);
+
+    // the newest frame is the one on screen, so go back to the one before it
+    if(!g_rewind.frame(1, &g_rewind_frame)) return;
+
+    RewindHeader header;
+    memcpy(&header, &g_rewind_frame[0], sizeof(RewindHeader));
+    if(!Entity::load_state(g_rewind_frame, sizeof(RewindHeader))) {
+        std::cerr << "Couldn't rewind, the frame is broken" << std::endl;
+        return;
+    }
+
+    state->world->set_position(Vector<int>(header.world_x, header.world_y, 0));
+    state->player_state.lives = header.lives;
+    state->player_state.score = header.score;
+    state->player_state.player->load_state(header.skratch);
+
+    g_rewind.drop(1);
+}
+
+
 /* this is used in the menu module */
 void exit_game(State* const state)
 {
@@ -162,6 +288,50 @@ void exit_game(State* const state)
 }
 
 
+/* the level after name (level01 -> level02), or empty if there isn't one */
+std::string next_level(const std::string& name)
+{
+    ENTER_FUNCTION(next_level);
+
+    const std::string::size_type digits = name.find_last_not_of("0123456789") + 1;
+    if(digits >= name.length()) return std::string();
+
+    // keep the zero padding
+    const int width = static_cast<int>(name.length() - digits);
+    char number[32];
+    snprintf(number, 32, "%0*d", width, atoi(name.c_str() + digits) + 1);
+
+    const std::string next(name.substr(0, digits) + number);
+
+    // only compiled levels can be played
+    struct stat buf;
+    if(stat((DATADIR "/levels/" + next + "/level.bin").c_str(), &buf)) return std::string();
+    return next;
+}
+
+
+/* puts a level in play, from the preloader if it has it, and starts preloading the one after it */
+bool load_world(State* const state, const std::string& name)
+{
+    ENTER_FUNCTION(load_world);
+
+    if(state->world) delete state->world;
+    state->world = g_preloader.take(name);
+    if(!state->world) {
+        // wasn't preloaded (or failed to), so load it here
+        state->world = new World();
+        if(!state->world->prepare(name, state->video_state, false)) return false;
+    }
+
+    if(!state->world->finish(state->video_state, state->player_state.player)) return false;
+    state->world->snapshot(&g_level_snapshot);
+
+    const std::string next(next_level(name));
+    if(!next.empty()) g_preloader.start(next, state->video_state);
+    return true;
+}
+
+
 /* this is used in the menu module */
 void new_game(State* const state)
 {
@@ -175,17 +345,18 @@ void new_game(State* const state)
     state->player_state.score = 0L;
 
     Entity::free_entities();
+    reset_rewind();
+    g_dirty_rects.invalidate();
 
     if(state->player_state.player) delete state->player_state.player;
     state->player_state.player = new Skratch();
     state->player_state.player->load_media(state->video_state);
 
-    if(state->world) delete state->world;
-    state->world = new World();
-    if(!state->world->load("level01", state->video_state, state->player_state.player)) {
+    if(!load_world(state, FIRST_LEVEL)) {
         std::cerr << "Couldn't load intro world" << std::endl;
         exit_game(state);
     }
+    PoolBase::reset_high_water_marks();
 }
 
 
@@ -198,13 +369,65 @@ void restart_game(State* const state)
     state->player_state.player->load_media(state->video_state);
 
     Entity::free_entities();
+    reset_rewind();
+    g_dirty_rects.invalidate();
 
-    if(state->world) delete state->world;
-    state->world = new World();
-    if(!state->world->load("level01", state->video_state, state->player_state.player)) {
-        std::cerr << "Couldn't load intro world" << std::endl;
+    // the level hasn't gone anywhere, so just put it back the way it started
+    if(state->world && state->world->restore(g_level_snapshot, state->video_state, state->player_state.player)) {
+        PoolBase::reset_high_water_marks();
+        return;
+    }
+
+    const std::string level(g_level_snapshot.name.empty() ? FIRST_LEVEL : g_level_snapshot.name);
+    if(!load_world(state, level)) {
+        std::cerr << "Couldn't load world " << level << std::endl;
         exit_game(state);
     }
+    PoolBase::reset_high_water_marks();
+}
+
+
+/* moves on to the next level, which has to be done preloading */
+void advance_level(State* const state, const std::string& name)
+{
+    ENTER_FUNCTION(advance_level);
+
+    // skratch starts the level fresh, but keeps his lives and score
+    if(state->player_state.player) delete state->player_state.player;
+    state->player_state.player = new Skratch();
+    state->player_state.player->load_media(state->video_state);
+
+    Entity::free_entities();
+    reset_rewind();
+    g_dirty_rects.invalidate();
+
+    if(!load_world(state, name)) {
+        std::cerr << "Couldn't load world " << name << std::endl;
+        exit_game(state);
+    }
+    PoolBase::reset_high_water_marks();
+}
+
+
+void render_world(World& world, bool dirty_rects)
+{
+    ENTER_FUNCTION(render_world);
+
+    if(!dirty_rects || g_dirty_rects.begin_frame(world.position())) {
+        Video::clear_window();
+        world.render();
+        return;
+    }
+
+    // the window still has last frame on it, so only what the sprites covered has to be put back
+    const std::vector<SDL_Rect>& damaged = g_dirty_rects.damaged();
+    for(std::vector<SDL_Rect>::const_iterator it = damaged.begin(); it != damaged.end(); ++it) {
+        SDL_Rect clip = *it;
+        Video::set_clip_rect(&clip);
+        Video::clear_window();
+        world.render();
+    }
+    Video::set_clip_rect(NULL);
 }
 
 
@@ -273,9 +496,9 @@ void handle_state(State* const state)
         handle_menu(state);
         break;
     case Running:
-        if(!state->paused) {
-            Entity::sort();
-
+        if(!state->paused && state->input_state.keystate[SDLK_r]) {
+            rewind_frame(state);
+        } else if(!state->paused) {
             Entity::all_think(*world);
             skratch->think(state->video_state, state->input_state.keystate, *world);
 
@@ -292,18 +515,28 @@ std::cout << "You lose!" << std::endl;
 exit_game(state);
                 }
             } else if(collisions[World::EndWorld]) {
+                const std::string next(next_level(world->name()));
+                if(next.empty()) {
 std::cout << "You win!" << std::endl;
 exit_game(state);
+                } else if(g_preloader.name() != next || g_preloader.ready()) {
+                    // if the preload never started, this has to wait on the disk
+                    advance_level(state, next);
+                    return;
+                }
+                // otherwise keep playing until the next level is ready
             }
         }
 
-        Video::clear_window();
+        render_world(*world, state->video_state.dirty_rects);
 
-        world->render();
+        // everything drawn over the world is where the next frame has to patch
+        if(state->video_state.dirty_rects) Video::set_dirty_rects(&g_dirty_rects);
         Entity::render_entities(*world);
         skratch->render(*world);
 
         render_hud(state->player_state, state->video_state, *(state->timer), state->fps, state->paused);
+        Video::set_dirty_rects(NULL);
 
         if(state->input_state.keystate[SDLK_F11]) {
             screenshot();
@@ -311,7 +544,11 @@ exit_game(state);
         }
 
         Entity::cleanup();
-        Video::flip();
+        if(!state->paused && !state->input_state.keystate[SDLK_r])
+            record_frame(state);
+
+        if(state->video_state.dirty_rects) g_dirty_rects.present();
+        else Video::flip();
         break;
     case EndGame: break;
     default:
@@ -383,10 +620,20 @@ void event_loop(State* const state)
                     std::cout << std::endl;
                 }
                 break;
+            case SDLK_b:
+                if(Running == state->game_state && state->world) {
+                    state->world->benchmark_collision(std::cout, 100000);
+                    std::cout << std::endl;
+                }
+                break;
             case SDLK_e:
                 if(Running == state->game_state) {
                     Entity::print_entities(std::cout);
                     std::cout << std::endl;
+                    PoolBase::print_pools(std::cout);
+                    std::cout << std::endl;
+                    g_rewind.print(std::cout);
+                    std::cout << std::endl;
                 }
                 break;
             case SDLK_f:
@@ -399,6 +646,10 @@ void event_loop(State* const state)
                 if(Running == state->game_state) {
                     Video::print_surfaces(std::cout);
                     std::cout << std::endl;
+                    Archetype::print_archetypes(std::cout);
+                    std::cout << std::endl;
+                    Tileset::print_tiles(std::cout);
+                    std::cout << std::endl;
                 }
                 break;
             default:
@@ -53,6 +53,7 @@ void sighandler(int signum)
     case SIGSEGV:
         std::cerr << "Segmentation Fault caught, exiting cleanly..." << std::endl;
         Callstack::dump(std::cerr);
+        save_rewind("skratch-crash.rewind");
         game_shutdown();
         exit(1);
     case SIGINT:
@@ -75,6 +76,9 @@ inline void print_usage()
             << "-height\t\tSet the window height" << std::endl
             << "-bpp\t\tSet the window depth" << std::endl
             << "-fullscreen\tRun in fullscreen mode" << std::endl
+            << "-scrollreuse\tOnly draw the tiles scrolled into view" << std::endl
+            << "-dirtyrects\tOnly draw what changed while the camera is still" << std::endl
+            << "-threads\tSet the number of entity update threads" << std::endl
             << "-nomusic\tTurn music off" << std::endl
             << "-nosound\tTurn sound off" << std::endl
             << "--help\t\tPrint this message" << std::endl << std::endl;
@@ -104,10 +108,18 @@ void process_arguments(const int argc, char* const argv[], State* const state)
                 exit(1);
             }
             state->video_state.bpp = std::atoi(argv[++i]);
+        } else if(!std::strcmp(argv[i], "-threads")) {
+            if(argc <= i+1) {
+                std::cerr << "Expected argument to -threads option" << std::endl;
+                exit(1);
+            }
+            state->threads = std::atoi(argv[++i]);
         } else if(!std::strcmp(argv[i], "-nomusic")) state->audio_state.music = false;
         else if(!std::strcmp(argv[i], "-nosound")) state->audio_state.sounds = false;
         else if(!std::strcmp(argv[i], "-fullscreen")) state->fullscreen = true;
         else if(!std::strcmp(argv[i], "-window")) state->fullscreen = false;
+        else if(!std::strcmp(argv[i], "-scrollreuse")) state->video_state.scroll_reuse = true;
+        else if(!std::strcmp(argv[i], "-dirtyrects")) state->video_state.dirty_rects = true;
         else if(!std::strcmp(argv[i], "--help")) {
             print_usage();
             exit(0);
@@ -53,6 +53,22 @@ void create_path(const std::string& path, unsigned int mode)
 }
 
 
+std::string get_cache_dir()
+{
+#if defined WIN32
+    const char* const base = getenv("LOCALAPPDATA");
+    if(base && *base) return std::string(base) + "\\skratch\\";
+#else
+    const char* const xdg = getenv("XDG_CACHE_HOME");
+    if(xdg && *xdg) return std::string(xdg) + "/skratch/";
+
+    const char* const home = getenv("HOME");
+    if(home && *home) return std::string(home) + "/.cache/skratch/";
+#endif
+    return std::string();
+}
+
+
 /*
  *  non-cross-platform functions
  *